@@ -0,0 +1,273 @@
+/*
+ * The driver is compiled into this file so that the internal calc_* functions
+ * can be timed one by one. Do not link it together with bme68x.c.
+ */
+#include "bme68x.c"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bme68x_bench.h"
+
+#define BENCH_ROUNDS_DEFAULT    2000u
+#define BENCH_N_INPUTS          256u
+
+#ifndef BME68X_USE_FPU
+typedef int64_t bench_val_t;
+typedef int32_t bench_fine_t;
+#define BENCH_T_SCALE           100.0
+#define BENCH_H_SCALE           1000.0
+#else
+typedef float bench_val_t;
+typedef float bench_fine_t;
+#define BENCH_T_SCALE           1.0
+#define BENCH_H_SCALE           1.0
+#endif
+
+/* Calibration blobs, as read from COEFF1 (0x8a), COEFF2 (0xe1) and COEFF3 (0x00) */
+static const uint8_t bench_calib[BME68X_BENCH_N_CALIB][BME68X_LEN_COEFF_ALL] = {
+    {
+        0xe5, 0x66, 0x03, 0x00, 0x05, 0x8e, 0x54, 0xd7, 0x58, 0x00, 0x3e, 0x1a, 0x74, 0xff,
+        0x26, 0x1e, 0x00, 0x00, 0x11, 0xf2, 0x5c, 0xf4, 0x1e, 0x3f, 0x43, 0x31, 0x00, 0x2d,
+        0x14, 0x78, 0x9c, 0xcc, 0x65, 0x15, 0xcf, 0xe2, 0x12, 0x2c, 0x00, 0x10, 0x00, 0x20,
+    },
+    {
+        0x38, 0x68, 0x03, 0x00, 0x20, 0x8c, 0xc6, 0xd6, 0x58, 0x00, 0x1d, 0x1d, 0xa1, 0xff,
+        0x1e, 0x1e, 0x00, 0x00, 0x61, 0xf7, 0xf4, 0xef, 0x1e, 0x41, 0x0b, 0x2e, 0x00, 0x2d,
+        0x14, 0x78, 0x9c, 0x6c, 0x63, 0x58, 0xd1, 0xe0, 0x12, 0x26, 0x00, 0x10, 0x00, 0xf0,
+    },
+    {
+        0x12, 0x66, 0x03, 0x00, 0x94, 0x90, 0x2a, 0xd8, 0x58, 0x00, 0x5d, 0x17, 0x45, 0xff,
+        0x2c, 0x1e, 0x00, 0x00, 0x04, 0xf0, 0xda, 0xf8, 0x1e, 0x3d, 0x9c, 0x32, 0x00, 0x2d,
+        0x14, 0x78, 0x9c, 0xdb, 0x68, 0x3e, 0xcc, 0xe4, 0x12, 0x33, 0x00, 0x20, 0x00, 0x00,
+    },
+    {
+        0x83, 0x69, 0x03, 0x00, 0x52, 0x8f, 0x31, 0xd6, 0x58, 0x00, 0xc6, 0x18, 0x87, 0xff,
+        0x23, 0x1e, 0x00, 0x00, 0xce, 0xf3, 0x53, 0xf2, 0x1e, 0x42, 0x20, 0x30, 0x00, 0x2d,
+        0x14, 0x78, 0x9c, 0x50, 0x61, 0x15, 0xd1, 0xde, 0x12, 0x2f, 0x00, 0x10, 0x00, 0x50,
+    },
+};
+
+/* Temperatures at which the pressure and humidity sweeps run */
+static const uint32_t bench_temp_points[3] = { 400000, 500000, 600000 };
+
+static volatile bench_val_t bench_sink;
+
+/* Register image the calibration is read from */
+static uint8_t bench_regs[256];
+
+static BME68X_INTF_RET_TYPE bench_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)intf_ptr;
+    for (uint32_t i = 0; i < length; i++) {
+        reg_data[i] = bench_regs[(uint8_t)(reg_addr + i)];
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static BME68X_INTF_RET_TYPE bench_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)reg_addr;
+    (void)reg_data;
+    (void)length;
+    (void)intf_ptr;
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void bench_delay_us(uint32_t period, void *intf_ptr)
+{
+    (void)period;
+    (void)intf_ptr;
+}
+
+/* Parse a calibration blob through the driver, as bme68x_init() would */
+static int8_t bench_load_calib(uint8_t idx, struct bme68x_dev *dev)
+{
+    const uint8_t *blob = bench_calib[idx];
+
+    memcpy(&bench_regs[BME68X_REG_COEFF1], blob, BME68X_LEN_COEFF1);
+    memcpy(&bench_regs[BME68X_REG_COEFF2], &blob[BME68X_LEN_COEFF1], BME68X_LEN_COEFF2);
+    memcpy(&bench_regs[BME68X_REG_COEFF3], &blob[BME68X_LEN_COEFF1 + BME68X_LEN_COEFF2], BME68X_LEN_COEFF3);
+
+    memset(dev, 0, sizeof(*dev));
+    dev->intf = BME68X_I2C_INTF;
+    dev->read = bench_read;
+    dev->write = bench_write;
+    dev->delay_us = bench_delay_us;
+    dev->amb_temp = 25;
+
+    return get_calib_data(dev);
+}
+
+static void emit_vec(const struct bme68x_bench_cfg *cfg,
+                     const char *q, uint8_t calib, uint32_t idx, uint32_t adc, uint32_t aux, double value)
+{
+    char line[96];
+
+    snprintf(line, sizeof(line), "%s %u %lu %lu %lu %.9g", q, calib, (unsigned long)idx, (unsigned long)adc,
+             (unsigned long)aux, value);
+    cfg->emit(line, cfg->arg);
+}
+
+int32_t bme68x_bench_golden(const struct bme68x_bench_cfg *cfg)
+{
+    struct bme68x_dev dev;
+    bench_fine_t t_fine;
+    int32_t n_lines = 0;
+    uint32_t idx, adc;
+    uint8_t c, k, range;
+    int8_t rslt;
+
+    for (c = 0; c < BME68X_BENCH_N_CALIB; c++) {
+        rslt = bench_load_calib(c, &dev);
+        if (rslt != BME68X_OK) {
+            return rslt;
+        }
+
+        /* Temperature over the ADC range the sensor reports, -40..85 degC and beyond */
+        for (idx = 0, adc = 300000; adc <= 700000; adc += 4000, idx++, n_lines++) {
+            double t = calc_temperature(adc, &t_fine, &dev.calib) / BENCH_T_SCALE;
+            emit_vec(cfg, "T", c, idx, adc, 0, t);
+        }
+
+        for (k = 0; k < 3; k++) {
+            (void)calc_temperature(bench_temp_points[k], &t_fine, &dev.calib);
+            for (idx = 0, adc = 100000; adc <= 600000; adc += 10000, idx++, n_lines++) {
+                emit_vec(cfg, "P", c, idx, adc, bench_temp_points[k], calc_pressure(adc, t_fine, &dev.calib));
+            }
+            for (idx = 0, adc = 5000; adc <= 50000; adc += 1000, idx++, n_lines++) {
+                double h = calc_humidity((uint16_t)adc, t_fine, &dev.calib) / BENCH_H_SCALE;
+                emit_vec(cfg, "H", c, idx, adc, bench_temp_points[k], h);
+            }
+        }
+
+        for (range = 0; range < 16; range++) {
+            for (idx = 0, adc = 0; adc < 1024; adc += 16, idx++, n_lines += 2) {
+                emit_vec(cfg, "GL", c, idx, adc, range, calc_gas_resistance_low((uint16_t)adc, range, &dev.calib));
+                emit_vec(cfg, "GH", c, idx, adc, range, calc_gas_resistance_high((uint16_t)adc, range));
+            }
+        }
+    }
+
+    return n_lines;
+}
+
+static void emit_ns(const struct bme68x_bench_cfg *cfg, const char *name, uint64_t t0, uint64_t t1, uint32_t calls)
+{
+    char line[64];
+
+    snprintf(line, sizeof(line), "ns %s %.2f", name, (double)(t1 - t0) / calls);
+    cfg->emit(line, cfg->arg);
+}
+
+int32_t bme68x_bench_timing(const struct bme68x_bench_cfg *cfg)
+{
+    static uint32_t temp_adc[BENCH_N_INPUTS], pres_adc[BENCH_N_INPUTS];
+    static uint16_t hum_adc[BENCH_N_INPUTS], gas_adc[BENCH_N_INPUTS], heatr[BENCH_N_INPUTS];
+    static uint8_t gas_range[BENCH_N_INPUTS];
+    static bench_fine_t t_fines[BENCH_N_INPUTS];
+    static struct bme68x_raw_data raw[BENCH_N_INPUTS];
+    uint32_t rounds = cfg->rounds ? cfg->rounds : BENCH_ROUNDS_DEFAULT;
+    uint32_t calls = rounds * BENCH_N_INPUTS;
+    struct bme68x_dev dev;
+    struct bme68x_data data;
+    bench_fine_t t_fine;
+    uint64_t t0;
+    uint32_t r, i;
+    int8_t rslt;
+
+    rslt = bench_load_calib(0, &dev);
+    if (rslt != BME68X_OK) {
+        return rslt;
+    }
+
+    for (i = 0; i < BENCH_N_INPUTS; i++) {
+        temp_adc[i] = 400000 + i * 800;
+        pres_adc[i] = 200000 + i * 1200;
+        hum_adc[i] = (uint16_t)(10000 + i * 120);
+        gas_adc[i] = (uint16_t)((i * 37) & 0x3ff);
+        gas_range[i] = (uint8_t)(i & 0x0f);
+        heatr[i] = (uint16_t)(200 + (i % 200));
+        (void)calc_temperature(temp_adc[i], &t_fines[i], &dev.calib);
+
+        memset(&raw[i], 0, sizeof(raw[i]));
+        raw[i].status = BME68X_NEW_DATA_MSK;
+        raw[i].field[2] = (uint8_t)(pres_adc[i] >> 12);
+        raw[i].field[3] = (uint8_t)(pres_adc[i] >> 4);
+        raw[i].field[4] = (uint8_t)(pres_adc[i] << 4);
+        raw[i].field[5] = (uint8_t)(temp_adc[i] >> 12);
+        raw[i].field[6] = (uint8_t)(temp_adc[i] >> 4);
+        raw[i].field[7] = (uint8_t)(temp_adc[i] << 4);
+        raw[i].field[8] = (uint8_t)(hum_adc[i] >> 8);
+        raw[i].field[9] = (uint8_t)hum_adc[i];
+        raw[i].field[13] = (uint8_t)(gas_adc[i] >> 2);
+        raw[i].field[14] = (uint8_t)((gas_adc[i] << 6) | gas_range[i]);
+    }
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_temperature(temp_adc[i], &t_fine, &dev.calib);
+        }
+    }
+    emit_ns(cfg, "calc_temperature", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_pressure(pres_adc[i], t_fines[i], &dev.calib);
+        }
+    }
+    emit_ns(cfg, "calc_pressure", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_humidity(hum_adc[i], t_fines[i], &dev.calib);
+        }
+    }
+    emit_ns(cfg, "calc_humidity", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_gas_resistance_low(gas_adc[i], gas_range[i], &dev.calib);
+        }
+    }
+    emit_ns(cfg, "calc_gas_resistance_low", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_gas_resistance_high(gas_adc[i], gas_range[i]);
+        }
+    }
+    emit_ns(cfg, "calc_gas_resistance_high", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_res_heat(heatr[i], &dev);
+        }
+    }
+    emit_ns(cfg, "calc_res_heat", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            bench_sink = calc_gas_wait(heatr[i]);
+        }
+    }
+    emit_ns(cfg, "calc_gas_wait", t0, cfg->clock_ns(), calls);
+
+    t0 = cfg->clock_ns();
+    for (r = 0; r < rounds; r++) {
+        for (i = 0; i < BENCH_N_INPUTS; i++) {
+            compensate_field(&raw[i], &data, &dev.calib, BME68X_VARIANT_GAS_LOW);
+            bench_sink = data.temperature + data.pressure + data.humidity + data.gas_resistance;
+        }
+    }
+    emit_ns(cfg, "compensate_field", t0, cfg->clock_ns(), calls);
+
+    return 0;
+}
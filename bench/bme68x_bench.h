@@ -0,0 +1,50 @@
+//
+// Portable conformance and timing benchmarks for the BME68x compensation.
+//
+// The same code runs on the Linux host and on target: the caller supplies a
+// clock and a line sink, nothing else is needed from the platform. Build it
+// once with and once without BME68X_DO_NOT_USE_FPU and compare the golden
+// outputs of the two builds to see what the integer build costs in accuracy.
+//
+
+#ifndef LAERA_BENCH_BME68X_BENCH_H
+#define LAERA_BENCH_BME68X_BENCH_H
+
+#include <stdint.h>
+
+/* Monotonic time in nanoseconds */
+typedef uint64_t (*bme68x_bench_clock_fn)(void);
+
+/* Receives one output line, without the trailing newline */
+typedef void (*bme68x_bench_emit_fn)(const char *line, void *arg);
+
+struct bme68x_bench_cfg {
+    bme68x_bench_clock_fn clock_ns;
+    bme68x_bench_emit_fn emit;
+    void *arg;
+
+    /* Rounds over the input set per timed function, 0 = default */
+    uint32_t rounds;
+};
+
+/* Number of calibration blobs in the golden set */
+#define BME68X_BENCH_N_CALIB    4u
+
+/*
+ * Emit the golden vector outputs of this build, one line per vector:
+ *   <quantity> <calib> <index> <adc> [<temp_adc>|<gas_range>] <value>
+ * Quantities are T (degC), P (Pa), H (%RH), GL and GH (Ohm, low and high
+ * gas variant). Values are in physical units whatever the build.
+ * Returns the number of lines, or a negative driver error.
+ */
+int32_t bme68x_bench_golden(const struct bme68x_bench_cfg *cfg);
+
+/*
+ * Emit the time per call of every calc_* function and of a full field
+ * compensation, one line each:
+ *   ns <function> <ns per call>
+ * Returns 0, or a negative driver error.
+ */
+int32_t bme68x_bench_timing(const struct bme68x_bench_cfg *cfg);
+
+#endif //LAERA_BENCH_BME68X_BENCH_H
@@ -39,51 +39,73 @@
 #include "bme68x.h"
 #include <stdio.h>
 
+/* 32 bit cores divide the gas resistance with 32 bit operations, host builds define this to test that path */
+#if (UINTPTR_MAX <= UINT32_MAX) && !defined(BME68X_DIV_U64_U32)
+#define BME68X_DIV_U64_U32
+#endif
+
 /* This internal API is used to read the calibration coefficients */
 static int8_t get_calib_data(struct bme68x_dev *dev);
 
+#ifndef BME68X_USE_FPU
+
+/* This internal API is used to derive the calibration-only compensation terms */
+static void calc_comp_data(struct bme68x_calib_data *calib);
+#endif
+
 /* This internal API is used to read variant ID information register status */
 static int8_t read_variant_id(struct bme68x_dev *dev);
 
+/* This internal API is used to calculate the CRC of a calibration cache */
+static uint16_t calc_cache_crc(const struct bme68x_calib_cache *cache);
+
 /* This internal API is used to calculate the gas wait */
 static uint8_t calc_gas_wait(uint16_t dur);
 
 #ifndef BME68X_USE_FPU
 
 /* This internal API is used to calculate the temperature in integer */
-static int16_t calc_temperature(uint32_t temp_adc, struct bme68x_dev *dev);
+static int16_t calc_temperature(uint32_t temp_adc, int32_t *t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the pressure in integer */
-static uint32_t calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev);
+static uint32_t calc_pressure(uint32_t pres_adc, int32_t t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the humidity in integer */
-static uint32_t calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev);
+static uint32_t calc_humidity(uint16_t hum_adc, int32_t t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the gas resistance high */
 static uint32_t calc_gas_resistance_high(uint16_t gas_res_adc, uint8_t gas_range);
 
 /* This internal API is used to calculate the gas resistance low */
-static uint32_t calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_dev *dev);
+static uint32_t calc_gas_resistance_low(uint16_t gas_res_adc,
+                                        uint8_t gas_range,
+                                        const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the heater resistance using integer */
 static uint8_t calc_res_heat(uint16_t temp, const struct bme68x_dev *dev);
 
+#ifdef BME68X_DIV_U64_U32
+
+/* This internal API is used to divide a 64 bit value with 32 bit operations only */
+static uint32_t div_u64_u32(uint64_t dividend, uint32_t divisor);
+#endif
+
 #else
 
 /* This internal API is used to calculate the temperature value in float */
-static float calc_temperature(uint32_t temp_adc, struct bme68x_dev *dev);
+static float calc_temperature(uint32_t temp_adc, float *t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the pressure value in float */
-static float calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev);
+static float calc_pressure(uint32_t pres_adc, float t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the humidity value in float */
-static float calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev);
+static float calc_humidity(uint16_t hum_adc, float t_fine, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the gas resistance high value in float */
 static float calc_gas_resistance_high(uint16_t gas_res_adc, uint8_t gas_range);
 
 /* This internal API is used to calculate the gas resistance low value in float */
-static float calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_dev *dev);
+static float calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_calib_data *calib);
 
 /* This internal API is used to calculate the heater resistance value using float */
 static uint8_t calc_res_heat(uint16_t temp, const struct bme68x_dev *dev);
@@ -91,10 +113,33 @@ static uint8_t calc_res_heat(uint16_t temp, const struct bme68x_dev *dev);
 #endif
 
 /* This internal API is used to read a single data of the sensor */
-static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bme68x_dev *dev);
-
-/* This internal API is used to read all data fields of the sensor */
-static int8_t read_all_field_data(struct bme68x_data * const data[], struct bme68x_dev *dev);
+static int8_t read_field_data(uint8_t index, uint8_t tries, struct bme68x_raw_data *data, struct bme68x_dev *dev);
+
+/* This internal API is used to read all data fields of the sensor in measurement order */
+static int8_t read_all_field_data(struct bme68x_raw_data *data, uint8_t *n_new, struct bme68x_dev *dev);
+
+/* This internal API is used to read the raw fields, polling at most tries times in forced mode */
+static int8_t get_raw_data(uint8_t op_mode,
+                           uint8_t tries,
+                           struct bme68x_raw_data *data,
+                           uint8_t *n_data,
+                           struct bme68x_dev *dev);
+
+/* This internal API is used to read and compensate the fields, polling at most tries times in forced mode */
+static int8_t get_data(uint8_t op_mode,
+                       uint8_t tries,
+                       struct bme68x_data *data,
+                       uint8_t *n_data,
+                       struct bme68x_dev *dev);
+
+/* This internal API is used to decode the status bytes of a field */
+static void parse_field_status(struct bme68x_raw_data *data, uint32_t variant_id);
+
+/* This internal API is used to compensate a single raw field */
+static void compensate_field(const struct bme68x_raw_data *raw_data,
+                             struct bme68x_data *data,
+                             const struct bme68x_calib_data *calib,
+                             uint32_t variant_id);
 
 /* This internal API is used to switch between SPI memory pages */
 static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev);
@@ -105,9 +150,34 @@ static int8_t get_mem_page(struct bme68x_dev *dev);
 /* This internal API is used to check the bme68x_dev for null pointers */
 static int8_t null_ptr_check(const struct bme68x_dev *dev);
 
+/* This internal API is used to mirror written registers into the shadow */
+static void update_shadow(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len, struct bme68x_dev *dev);
+
+/* This internal API is used to check if the control registers can be taken from the shadow */
+static uint8_t ctrl_shadowed(const struct bme68x_dev *dev);
+
+/* This internal API is used to bring an asynchronous measurement to sleep mode, then trigger it */
+static int8_t async_trigger(struct bme68x_async *async, struct bme68x_dev *dev);
+
+/* This internal API is used to end an asynchronous measurement and report it */
+static void async_done(int8_t rslt, struct bme68x_async *async);
+
+/* This internal API is used to arm the polls for new data of an asynchronous measurement */
+static void async_arm_polls(struct bme68x_async *async);
+
 /* This internal API is used to set heater configurations */
 static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme68x_dev *dev);
 
+/* This internal API is used to calculate the res_heat, gas_wait and shared duration registers */
+static int8_t calc_heatr_regs(const struct bme68x_heatr_conf *conf,
+                              uint8_t op_mode,
+                              struct bme68x_heatr_image *image,
+                              uint8_t *n_steps,
+                              const struct bme68x_dev *dev);
+
+/* This internal API is used to select the heater control and run_gas bits */
+static void calc_gas_ctrl(uint8_t enable, uint32_t variant_id, uint8_t *hctrl, uint8_t *run_gas);
+
 /* This internal API is used to limit the max value of a parameter */
 static int8_t boundary_check(uint8_t *value, uint8_t max, struct bme68x_dev *dev);
 
@@ -115,11 +185,8 @@ static int8_t boundary_check(uint8_t *value, uint8_t max, struct bme68x_dev *dev
  * shared heater duration */
 static uint8_t calc_heatr_dur_shared(uint16_t dur);
 
-/* This internal API is used to swap two fields */
-static void swap_fields(uint8_t index1, uint8_t index2, struct bme68x_data *field[]);
-
-/* This internal API is used sort the sensor data */
-static void sort_sensor_data(uint8_t low_index, uint8_t high_index, struct bme68x_data *field[]);
+/* This internal API is used to compute where each of the 3 fields goes, the oldest new field first */
+static uint8_t calc_field_order(const uint8_t *buff, uint8_t *pos);
 
 /*
  * @brief       Function to analyze the sensor data
@@ -161,6 +228,11 @@ int8_t bme68x_init(struct bme68x_dev *dev)
                 /* Get the Calibration data */
                 rslt = get_calib_data(dev);
             }
+
+            if ((rslt == BME68X_OK) && dev->shadow_en)
+            {
+                rslt = bme68x_sync_shadow(dev);
+            }
         }
         else
         {
@@ -171,6 +243,111 @@ int8_t bme68x_init(struct bme68x_dev *dev)
     return rslt;
 }
 
+/*
+ * @brief This API initializes the device from a calibration cache, without
+ * resetting the sensor.
+ */
+int8_t bme68x_init_cached(const struct bme68x_calib_cache *cache, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t fprint[BME68X_LEN_CALIB_FPRINT];
+    uint8_t i;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (cache != NULL))
+    {
+        if ((cache->len != sizeof(*cache)) || (cache->magic != BME68X_CALIB_CACHE_MAGIC) ||
+            (cache->chip_id != BME68X_CHIP_ID) || (cache->crc != calc_cache_crc(cache)))
+        {
+            rslt = BME68X_E_CALIB_CACHE;
+        }
+
+        if ((rslt == BME68X_OK) && (dev->intf == BME68X_SPI_INTF))
+        {
+            rslt = get_mem_page(dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = bme68x_get_regs(BME68X_REG_CHIP_ID, &dev->chip_id, 1, dev);
+        }
+
+        if ((rslt == BME68X_OK) && (dev->chip_id != BME68X_CHIP_ID))
+        {
+            rslt = BME68X_E_DEV_NOT_FOUND;
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            /* A sensor swap changes the calibration and variant registers */
+            rslt = bme68x_get_regs(BME68X_REG_COEFF2, fprint, BME68X_LEN_CALIB_FPRINT, dev);
+            for (i = 0; (i < BME68X_LEN_CALIB_FPRINT) && (rslt == BME68X_OK); i++)
+            {
+                if (fprint[i] != cache->fprint[i])
+                {
+                    rslt = BME68X_E_CALIB_CACHE;
+                }
+            }
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            dev->variant_id = cache->variant_id;
+            dev->calib = cache->calib;
+
+            /* The sensor was not reset, its registers are unknown */
+            dev->shadow_valid = 0;
+            if (dev->shadow_en)
+            {
+                rslt = bme68x_sync_shadow(dev);
+            }
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API saves the calibration data of an initialized device.
+ */
+int8_t bme68x_get_calib_cache(struct bme68x_calib_cache *cache, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t *bytes = (uint8_t *)cache;
+    uint16_t i;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (cache != NULL))
+    {
+        /* Padding is covered by the CRC, clear it */
+        for (i = 0; i < sizeof(*cache); i++)
+        {
+            bytes[i] = 0;
+        }
+
+        rslt = bme68x_get_regs(BME68X_REG_COEFF2, cache->fprint, BME68X_LEN_CALIB_FPRINT, dev);
+        if (rslt == BME68X_OK)
+        {
+            cache->len = sizeof(*cache);
+            cache->magic = BME68X_CALIB_CACHE_MAGIC;
+            cache->chip_id = dev->chip_id;
+            cache->variant_id = dev->variant_id;
+            cache->calib = dev->calib;
+            cache->crc = calc_cache_crc(cache);
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
 /*
  * @brief This API writes the given data to the register address of the sensor
  */
@@ -212,6 +389,13 @@ int8_t bme68x_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_
                 if (dev->intf_rslt != 0)
                 {
                     rslt = BME68X_E_COM_FAIL;
+
+                    /* The sensor state is unknown after a failed write */
+                    dev->shadow_valid = 0;
+                }
+                else if (dev->shadow_valid)
+                {
+                    update_shadow(reg_addr, reg_data, len, dev);
                 }
             }
         }
@@ -290,14 +474,14 @@ int8_t bme68x_soft_reset(struct bme68x_dev *dev)
 
             if (rslt == BME68X_OK)
             {
+                /* Registers are back to their reset values */
+                dev->shadow_valid = 0;
+
                 /* Wait for 5ms */
                 dev->delay_us(BME68X_PERIOD_RESET, dev->intf_ptr);
 
-                /* After reset get the memory page */
-                if (dev->intf == BME68X_SPI_INTF)
-                {
-                    rslt = get_mem_page(dev);
-                }
+                /* After reset spi_mem_page is 0, the page of registers 0x80 to 0xFF */
+                dev->mem_page = BME68X_MEM_PAGE1;
             }
         }
     }
@@ -305,6 +489,29 @@ int8_t bme68x_soft_reset(struct bme68x_dev *dev)
     return rslt;
 }
 
+/*
+ * @brief This API refills the register shadow from the sensor.
+ */
+int8_t bme68x_sync_shadow(struct bme68x_dev *dev)
+{
+    int8_t rslt;
+
+    rslt = null_ptr_check(dev);
+    if (rslt == BME68X_OK)
+    {
+        dev->shadow_valid = 0;
+
+        /* IDAC_HEAT_0 up to CONFIG are contiguous, one burst read */
+        rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0, dev->shadow, BME68X_LEN_SHADOW, dev);
+        if (rslt == BME68X_OK)
+        {
+            dev->shadow_valid = 1;
+        }
+    }
+
+    return rslt;
+}
+
 /*
  * @brief This API is used to set the oversampling, filter and odr configuration
  */
@@ -313,6 +520,7 @@ int8_t bme68x_set_conf(struct bme68x_conf *conf, struct bme68x_dev *dev)
     int8_t rslt;
     uint8_t odr20 = 0, odr3 = 1;
     uint8_t current_op_mode;
+    uint8_t i;
 
     /* Register data starting from BME68X_REG_CTRL_GAS_1(0x71) up to BME68X_REG_CONFIG(0x75) */
     uint8_t reg_array[BME68X_LEN_CONFIG] = { 0x71, 0x72, 0x73, 0x74, 0x75 };
@@ -332,7 +540,21 @@ int8_t bme68x_set_conf(struct bme68x_conf *conf, struct bme68x_dev *dev)
     else if (rslt == BME68X_OK)
     {
         /* Read the whole configuration and write it back once later */
-        rslt = bme68x_get_regs(reg_array[0], data_array, BME68X_LEN_CONFIG, dev);
+        if (ctrl_shadowed(dev))
+        {
+            for (i = 0; i < BME68X_LEN_CONFIG; i++)
+            {
+                data_array[i] = dev->shadow[reg_array[i] - BME68X_REG_IDAC_HEAT0];
+            }
+        }
+        else
+        {
+            rslt = bme68x_get_regs(reg_array[0], data_array, BME68X_LEN_CONFIG, dev);
+        }
+
+        /* The sensor sleeps now, a finished forced mode in the shadow must not start a new measurement */
+        data_array[3] &= ~BME68X_MODE_MSK;
+
         dev->info_msg = BME68X_OK;
         if (rslt == BME68X_OK)
         {
@@ -399,8 +621,22 @@ int8_t bme68x_get_conf(struct bme68x_conf *conf, struct bme68x_dev *dev)
     /* starting address of the register array for burst read*/
     uint8_t reg_addr = BME68X_REG_CTRL_GAS_1;
     uint8_t data_array[BME68X_LEN_CONFIG];
+    uint8_t i;
+
+    if (ctrl_shadowed(dev))
+    {
+        for (i = 0; i < BME68X_LEN_CONFIG; i++)
+        {
+            data_array[i] = dev->shadow[reg_addr + i - BME68X_REG_IDAC_HEAT0];
+        }
+
+        rslt = BME68X_OK;
+    }
+    else
+    {
+        rslt = bme68x_get_regs(reg_addr, data_array, 5, dev);
+    }
 
-    rslt = bme68x_get_regs(reg_addr, data_array, 5, dev);
     if (!conf)
     {
         rslt = BME68X_E_NULL_PTR;
@@ -434,8 +670,21 @@ int8_t bme68x_set_op_mode(const uint8_t op_mode, struct bme68x_dev *dev)
     uint8_t pow_mode = 0;
     uint8_t reg_addr = BME68X_REG_CTRL_MEAS;
 
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && ctrl_shadowed(dev))
+    {
+        /* A forced measurement may still run until its data was read, then the loop reads the mode back */
+        tmp_pow_mode = dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0];
+        pow_mode = (tmp_pow_mode & BME68X_MODE_MSK);
+    }
+    else
+    {
+        /* Unknown state, read back the mode */
+        pow_mode = BME68X_FORCED_MODE;
+    }
+
     /* Call until in sleep */
-    do
+    while ((pow_mode != BME68X_SLEEP_MODE) && (rslt == BME68X_OK))
     {
         rslt = bme68x_get_regs(BME68X_REG_CTRL_MEAS, &tmp_pow_mode, 1, dev);
         if (rslt == BME68X_OK)
@@ -449,7 +698,7 @@ int8_t bme68x_set_op_mode(const uint8_t op_mode, struct bme68x_dev *dev)
                 dev->delay_us(BME68X_PERIOD_POLL, dev->intf_ptr);
             }
         }
-    } while ((pow_mode != BME68X_SLEEP_MODE) && (rslt == BME68X_OK));
+    }
 
     /* Already in sleep */
     if ((op_mode != BME68X_SLEEP_MODE) && (rslt == BME68X_OK))
@@ -467,11 +716,21 @@ int8_t bme68x_set_op_mode(const uint8_t op_mode, struct bme68x_dev *dev)
 int8_t bme68x_get_op_mode(uint8_t *op_mode, struct bme68x_dev *dev)
 {
     int8_t rslt;
-    uint8_t mode;
+    uint8_t mode = 0;
 
     if (op_mode)
     {
-        rslt = bme68x_get_regs(BME68X_REG_CTRL_MEAS, &mode, 1, dev);
+        /* A forced measurement in the shadow may still run, only the sensor knows */
+        if (ctrl_shadowed(dev) &&
+            ((dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0] & BME68X_MODE_MSK) != BME68X_FORCED_MODE))
+        {
+            mode = dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0];
+            rslt = BME68X_OK;
+        }
+        else
+        {
+            rslt = bme68x_get_regs(BME68X_REG_CTRL_MEAS, &mode, 1, dev);
+        }
 
         /* Masking the other register bit info*/
         *op_mode = mode & BME68X_MODE_MSK;
@@ -532,6 +791,15 @@ uint32_t bme68x_get_meas_dur(const uint8_t op_mode, struct bme68x_conf *conf, st
     return meas_dur;
 }
 
+/*
+ * @brief This API reads the undecoded field registers of the sensor together
+ * with status, gas index and measurement index, without compensating them.
+ */
+int8_t bme68x_get_raw_data(uint8_t op_mode, struct bme68x_raw_data *data, uint8_t *n_data, struct bme68x_dev *dev)
+{
+    return get_raw_data(op_mode, BME68X_READ_TRIES, data, n_data, dev);
+}
+
 /*
  * @brief This API reads the pressure, temperature and humidity and gas data
  * from the sensor, compensates the data and store it in the bme68x_data
@@ -539,82 +807,38 @@ uint32_t bme68x_get_meas_dur(const uint8_t op_mode, struct bme68x_conf *conf, st
  */
 int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev)
 {
-    int8_t rslt;
-    uint8_t i = 0, j = 0, new_fields = 0;
-    struct bme68x_data *field_ptr[3] = { 0 };
-    struct bme68x_data field_data[3] = { { 0 } };
+    return get_data(op_mode, BME68X_READ_TRIES, data, n_data, dev);
+}
 
-    field_ptr[0] = &field_data[0];
-    field_ptr[1] = &field_data[1];
-    field_ptr[2] = &field_data[2];
+/*
+ * @brief This API starts a measurement without waiting on the sensor.
+ */
+int8_t bme68x_async_start(uint8_t op_mode, uint32_t meas_dur, struct bme68x_async *async, struct bme68x_dev *dev)
+{
+    int8_t rslt;
 
     rslt = null_ptr_check(dev);
-    if ((rslt == BME68X_OK) && (data != NULL))
+    if ((rslt == BME68X_OK) && (async != NULL))
     {
-        /* Reading the sensor data in forced mode only */
-        if (op_mode == BME68X_FORCED_MODE)
-        {
-            rslt = read_field_data(0, data, dev);
-            if (rslt == BME68X_OK)
-            {
-                if (data->status & BME68X_NEW_DATA_MSK)
-                {
-                    new_fields = 1;
-                }
-                else
-                {
-                    new_fields = 0;
-                    rslt = BME68X_W_NO_NEW_DATA;
-                }
-            }
-        }
-        else if ((op_mode == BME68X_PARALLEL_MODE) || (op_mode == BME68X_SEQUENTIAL_MODE))
+        if ((op_mode == BME68X_FORCED_MODE) || (op_mode == BME68X_PARALLEL_MODE) ||
+            (op_mode == BME68X_SEQUENTIAL_MODE))
         {
-            /* Read the 3 fields and count the number of new data fields */
-            rslt = read_all_field_data(field_ptr, dev);
-
-            new_fields = 0;
-            for (i = 0; (i < 3) && (rslt == BME68X_OK); i++)
-            {
-                if (field_ptr[i]->status & BME68X_NEW_DATA_MSK)
-                {
-                    new_fields++;
-                }
-            }
-
-            /* Sort the sensor data in parallel & sequential modes*/
-            for (i = 0; (i < 2) && (rslt == BME68X_OK); i++)
-            {
-                for (j = i + 1; j < 3; j++)
-                {
-                    sort_sensor_data(i, j, field_ptr);
-                }
-            }
-
-            /* Copy the sorted data */
-            for (i = 0; ((i < 3) && (rslt == BME68X_OK)); i++)
-            {
-                data[i] = *field_ptr[i];
-            }
-
-            if (new_fields == 0)
+            async->op_mode = op_mode;
+            async->meas_dur = meas_dur;
+            async->n_data = 0;
+            async->state = BME68X_ASYNC_IDLE;
+
+            /* Takes the first step right away, a shadowed sensor in sleep mode is triggered here */
+            rslt = async_trigger(async, dev);
+            if (rslt < BME68X_OK)
             {
-                rslt = BME68X_W_NO_NEW_DATA;
+                async->state = BME68X_ASYNC_IDLE;
             }
         }
         else
         {
             rslt = BME68X_W_DEFINE_OP_MODE;
         }
-
-        if (n_data == NULL)
-        {
-            rslt = BME68X_E_NULL_PTR;
-        }
-        else
-        {
-            *n_data = new_fields;
-        }
     }
     else
     {
@@ -625,52 +849,53 @@ int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_dat
 }
 
 /*
- * @brief This API is used to set the gas configuration of the sensor.
+ * @brief This API advances an asynchronous measurement by one step.
  */
-int8_t bme68x_set_heatr_conf(uint8_t op_mode, const struct bme68x_heatr_conf *conf, struct bme68x_dev *dev)
+int8_t bme68x_async_step(struct bme68x_async *async, struct bme68x_dev *dev)
 {
     int8_t rslt;
-    uint8_t hctrl, nb_conv = 0;
-    uint8_t run_gas = 0;
-    uint8_t ctrl_gas_data[2];
-    uint8_t ctrl_gas_addr[2] = { BME68X_REG_CTRL_GAS_0, BME68X_REG_CTRL_GAS_1 };
 
-    if (conf != NULL)
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (async != NULL))
     {
-        rslt = bme68x_set_op_mode(BME68X_SLEEP_MODE, dev);
-        if (rslt == BME68X_OK)
+        switch (async->state)
         {
-            rslt = set_conf(conf, op_mode, &nb_conv, dev);
-        }
+            case BME68X_ASYNC_SLEEP:
+                rslt = async_trigger(async, dev);
+                if (rslt < BME68X_OK)
+                {
+                    async_done(rslt, async);
+                }
 
-        if (rslt == BME68X_OK)
-        {
-            rslt = bme68x_get_regs(BME68X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
-            if (rslt == BME68X_OK)
-            {
-                if (conf->enable == BME68X_ENABLE)
+                break;
+            case BME68X_ASYNC_MEAS:
+
+                /* One poll, the caller waits between polls */
+                if (async->raw)
                 {
-                    hctrl = BME68X_ENABLE_HEATER;
-                    if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-                    {
-                        run_gas = BME68X_ENABLE_GAS_MEAS_H;
-                    }
-                    else
-                    {
-                        run_gas = BME68X_ENABLE_GAS_MEAS_L;
-                    }
+                    rslt = get_raw_data(async->op_mode, 1, async->raw_data, &async->n_data, dev);
                 }
                 else
                 {
-                    hctrl = BME68X_DISABLE_HEATER;
-                    run_gas = BME68X_DISABLE_GAS_MEAS;
+                    rslt = get_data(async->op_mode, 1, async->data, &async->n_data, dev);
                 }
 
-                ctrl_gas_data[0] = BME68X_SET_BITS(ctrl_gas_data[0], BME68X_HCTRL, hctrl);
-                ctrl_gas_data[1] = BME68X_SET_BITS_POS_0(ctrl_gas_data[1], BME68X_NBCONV, nb_conv);
-                ctrl_gas_data[1] = BME68X_SET_BITS(ctrl_gas_data[1], BME68X_RUN_GAS, run_gas);
-                rslt = bme68x_set_regs(ctrl_gas_addr, ctrl_gas_data, 2, dev);
-            }
+                if ((rslt == BME68X_W_NO_NEW_DATA) && (async->tries > 1))
+                {
+                    async->tries--;
+                    async->wait_us = async->poll_us ? async->poll_us : BME68X_PERIOD_POLL;
+                    rslt = BME68X_W_ASYNC_BUSY;
+                }
+                else
+                {
+                    async_done(rslt, async);
+                }
+
+                break;
+            default:
+
+                /* Nothing running */
+                break;
         }
     }
     else
@@ -681,25 +906,523 @@ int8_t bme68x_set_heatr_conf(uint8_t op_mode, const struct bme68x_heatr_conf *co
     return rslt;
 }
 
-/*!
- * @brief This API is used to get the gas configuration of the sensor.
+/*
+ * @brief This API puts the sensor to sleep and ends an asynchronous measurement.
  */
-int8_t bme68x_get_heatr_conf(const struct bme68x_heatr_conf *conf, struct bme68x_dev *dev)
+int8_t bme68x_async_stop(struct bme68x_async *async, struct bme68x_dev *dev)
 {
-    int8_t rslt = BME68X_OK;
-    uint8_t data_array[10] = { 0 };
-    uint8_t i;
+    int8_t rslt;
+    uint8_t reg_addr = BME68X_REG_CTRL_MEAS;
+    uint8_t ctrl_meas;
 
-    if ((conf != NULL) && (conf->heatr_dur_prof != NULL) && (conf->heatr_temp_prof != NULL))
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (async != NULL))
     {
-        /* FIXME: Add conversion to deg C and ms and add the other parameters */
-        rslt = bme68x_get_regs(BME68X_REG_RES_HEAT0, data_array, 10, dev);
-
-        if (rslt == BME68X_OK)
+        if (async->state != BME68X_ASYNC_IDLE)
         {
-            for (i = 0; i < conf->profile_len; i++)
+            /* No read back, a running mode only needs its mode bits cleared */
+            ctrl_meas = async->ctrl_meas & ~BME68X_MODE_MSK;
+            rslt = bme68x_set_regs(&reg_addr, &ctrl_meas, 1, dev);
+            if (rslt == BME68X_OK)
             {
-                conf->heatr_temp_prof[i] = data_array[i];
+                async->ctrl_meas = ctrl_meas;
+            }
+
+            async->state = BME68X_ASYNC_IDLE;
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API compensates raw fields read by bme68x_get_raw_data().
+ */
+int8_t bme68x_compensate_raw(const struct bme68x_raw_data *raw_data,
+                             uint8_t n_data,
+                             struct bme68x_data *data,
+                             const struct bme68x_calib_data *calib,
+                             uint32_t variant_id)
+{
+    int8_t rslt = BME68X_OK;
+    uint8_t i;
+
+    if ((raw_data != NULL) && (data != NULL) && (calib != NULL))
+    {
+        for (i = 0; i < n_data; i++)
+        {
+            compensate_field(&raw_data[i], &data[i], calib, variant_id);
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API compensates a batch of raw ADC values, one pass per quantity.
+ */
+int8_t bme68x_compensate_batch(const struct bme68x_raw_batch *raw,
+                               struct bme68x_data_batch *data,
+                               uint32_t n_data,
+                               const struct bme68x_calib_data *calib,
+                               uint32_t variant_id)
+{
+    int8_t rslt = BME68X_OK;
+    uint32_t off, i, n;
+
+    /* Local copy so that the output stores cannot alias the coefficients */
+    struct bme68x_calib_data cal;
+
+#ifndef BME68X_USE_FPU
+    int32_t t_fine[BME68X_BATCH_CHUNK];
+    int16_t *temp;
+    uint32_t *pres, *hum, *gas;
+#else
+    float t_fine[BME68X_BATCH_CHUNK];
+    float *temp, *pres, *hum, *gas;
+#endif
+    const uint32_t *temp_adc, *pres_adc;
+    const uint16_t *hum_adc, *gas_adc;
+    const uint8_t *gas_range;
+
+    if ((raw == NULL) || (data == NULL) || (calib == NULL) || (raw->temp_adc == NULL) ||
+        (data->temperature == NULL) || ((raw->pres_adc != NULL) && (data->pressure == NULL)) ||
+        ((raw->hum_adc != NULL) && (data->humidity == NULL)) ||
+        ((raw->gas_adc != NULL) && ((raw->gas_range == NULL) || (data->gas_resistance == NULL))))
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+    else
+    {
+        cal = *calib;
+        for (off = 0; off < n_data; off += n)
+        {
+            n = n_data - off;
+            if (n > BME68X_BATCH_CHUNK)
+            {
+                n = BME68X_BATCH_CHUNK;
+            }
+
+            /* One pass per quantity over the chunk, each without loop-carried state */
+            temp_adc = &raw->temp_adc[off];
+            temp = &data->temperature[off];
+            for (i = 0; i < n; i++)
+            {
+                temp[i] = calc_temperature(temp_adc[i], &t_fine[i], &cal);
+            }
+
+            if (raw->pres_adc != NULL)
+            {
+                pres_adc = &raw->pres_adc[off];
+                pres = &data->pressure[off];
+                for (i = 0; i < n; i++)
+                {
+                    pres[i] = calc_pressure(pres_adc[i], t_fine[i], &cal);
+                }
+            }
+
+            if (raw->hum_adc != NULL)
+            {
+                hum_adc = &raw->hum_adc[off];
+                hum = &data->humidity[off];
+                for (i = 0; i < n; i++)
+                {
+                    hum[i] = calc_humidity(hum_adc[i], t_fine[i], &cal);
+                }
+            }
+
+            if (raw->gas_adc != NULL)
+            {
+                gas_adc = &raw->gas_adc[off];
+                gas_range = &raw->gas_range[off];
+                gas = &data->gas_resistance[off];
+                if (variant_id == BME68X_VARIANT_GAS_HIGH)
+                {
+                    for (i = 0; i < n; i++)
+                    {
+                        gas[i] = calc_gas_resistance_high(gas_adc[i], gas_range[i] & BME68X_GAS_RANGE_MSK);
+                    }
+                }
+                else
+                {
+                    for (i = 0; i < n; i++)
+                    {
+                        gas[i] = calc_gas_resistance_low(gas_adc[i], gas_range[i] & BME68X_GAS_RANGE_MSK, &cal);
+                    }
+                }
+            }
+        }
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API is used to set the gas configuration of the sensor.
+ */
+int8_t bme68x_set_heatr_conf(uint8_t op_mode, const struct bme68x_heatr_conf *conf, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t hctrl, nb_conv = 0;
+    uint8_t run_gas;
+    uint8_t ctrl_gas_data[2];
+    uint8_t ctrl_gas_addr[2] = { BME68X_REG_CTRL_GAS_0, BME68X_REG_CTRL_GAS_1 };
+
+    if (conf != NULL)
+    {
+        rslt = bme68x_set_op_mode(BME68X_SLEEP_MODE, dev);
+        if (rslt == BME68X_OK)
+        {
+            rslt = set_conf(conf, op_mode, &nb_conv, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            if (ctrl_shadowed(dev))
+            {
+                ctrl_gas_data[0] = dev->shadow[BME68X_REG_CTRL_GAS_0 - BME68X_REG_IDAC_HEAT0];
+                ctrl_gas_data[1] = dev->shadow[BME68X_REG_CTRL_GAS_1 - BME68X_REG_IDAC_HEAT0];
+            }
+            else
+            {
+                rslt = bme68x_get_regs(BME68X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
+            }
+
+            if (rslt == BME68X_OK)
+            {
+                calc_gas_ctrl(conf->enable, dev->variant_id, &hctrl, &run_gas);
+                ctrl_gas_data[0] = BME68X_SET_BITS(ctrl_gas_data[0], BME68X_HCTRL, hctrl);
+                ctrl_gas_data[1] = BME68X_SET_BITS_POS_0(ctrl_gas_data[1], BME68X_NBCONV, nb_conv);
+                ctrl_gas_data[1] = BME68X_SET_BITS(ctrl_gas_data[1], BME68X_RUN_GAS, run_gas);
+                rslt = bme68x_set_regs(ctrl_gas_addr, ctrl_gas_data, 2, dev);
+            }
+        }
+
+        /* Capture the registers once, later writes are mirrored by bme68x_set_regs */
+        if ((rslt == BME68X_OK) && dev->shadow_en && !dev->shadow_valid)
+        {
+            rslt = bme68x_sync_shadow(dev);
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API compiles a heater configuration to register values.
+ */
+int8_t bme68x_compile_heatr_conf(uint8_t op_mode,
+                                 const struct bme68x_heatr_conf *conf,
+                                 struct bme68x_heatr_image *image,
+                                 const struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t n_steps = 0;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (conf != NULL) && (image != NULL))
+    {
+        rslt = calc_heatr_regs(conf, op_mode, image, &n_steps, dev);
+        if ((rslt == BME68X_OK) && (n_steps == 0))
+        {
+            rslt = BME68X_E_INVALID_LENGTH;
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            image->op_mode = op_mode;
+            image->amb_temp = dev->amb_temp;
+            image->nb_conv = (op_mode == BME68X_FORCED_MODE) ? 0 : n_steps;
+            calc_gas_ctrl(conf->enable, dev->variant_id, &image->hctrl, &image->run_gas);
+
+            /* The other bits of CTRL_GAS_* are only known when the image is applied */
+            image->reg_addr[image->len] = BME68X_REG_CTRL_GAS_0;
+            image->reg_data[image->len] = 0;
+            image->len++;
+            image->reg_addr[image->len] = BME68X_REG_CTRL_GAS_1;
+            image->reg_data[image->len] = 0;
+            image->len++;
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API writes a compiled heater configuration in one transaction.
+ */
+int8_t bme68x_set_heatr_image(const struct bme68x_heatr_image *image, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t reg_data[BME68X_LEN_HEATR_IMAGE];
+    uint8_t ctrl_gas_data[2];
+    uint8_t i, len;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (image != NULL))
+    {
+        len = image->len;
+        if ((len < 3) || (len > BME68X_LEN_HEATR_IMAGE))
+        {
+            rslt = BME68X_E_INVALID_LENGTH;
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = bme68x_set_op_mode(BME68X_SLEEP_MODE, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            if (ctrl_shadowed(dev))
+            {
+                ctrl_gas_data[0] = dev->shadow[BME68X_REG_CTRL_GAS_0 - BME68X_REG_IDAC_HEAT0];
+                ctrl_gas_data[1] = dev->shadow[BME68X_REG_CTRL_GAS_1 - BME68X_REG_IDAC_HEAT0];
+            }
+            else
+            {
+                rslt = bme68x_get_regs(BME68X_REG_CTRL_GAS_0, ctrl_gas_data, 2, dev);
+            }
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            for (i = 0; i < len; i++)
+            {
+                reg_data[i] = image->reg_data[i];
+            }
+
+            reg_data[len - 2] = BME68X_SET_BITS(ctrl_gas_data[0], BME68X_HCTRL, image->hctrl);
+            reg_data[len - 1] = BME68X_SET_BITS_POS_0(ctrl_gas_data[1], BME68X_NBCONV, image->nb_conv);
+            reg_data[len - 1] = BME68X_SET_BITS(reg_data[len - 1], BME68X_RUN_GAS, image->run_gas);
+
+            /* One burst of address and data pairs */
+            rslt = bme68x_set_regs(image->reg_addr, reg_data, len, dev);
+        }
+
+        if ((rslt == BME68X_OK) && dev->shadow_en && !dev->shadow_valid)
+        {
+            rslt = bme68x_sync_shadow(dev);
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API compiles the sensor and heater configuration to register values.
+ */
+int8_t bme68x_compile_conf(uint8_t op_mode,
+                           struct bme68x_conf *conf,
+                           const struct bme68x_heatr_conf *heatr_conf,
+                           struct bme68x_conf_image *image,
+                           struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t odr20 = 0, odr3 = 1;
+    uint8_t len;
+    struct bme68x_heatr_image heatr_image;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (conf != NULL) && (heatr_conf != NULL) && (image != NULL))
+    {
+        dev->info_msg = BME68X_OK;
+        rslt = boundary_check(&conf->filter, BME68X_FILTER_SIZE_127, dev);
+        if (rslt == BME68X_OK)
+        {
+            rslt = boundary_check(&conf->os_temp, BME68X_OS_16X, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = boundary_check(&conf->os_pres, BME68X_OS_16X, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = boundary_check(&conf->os_hum, BME68X_OS_16X, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = boundary_check(&conf->odr, BME68X_ODR_NONE, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = bme68x_compile_heatr_conf(op_mode, heatr_conf, &heatr_image, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            /* Heater registers, CTRL_GAS_0 and CTRL_GAS_1 excluded */
+            for (len = 0; len < (heatr_image.len - 2); len++)
+            {
+                image->reg_addr[len] = heatr_image.reg_addr[len];
+                image->reg_data[len] = heatr_image.reg_data[len];
+            }
+
+            if (conf->odr != BME68X_ODR_NONE)
+            {
+                odr20 = conf->odr;
+                odr3 = 0;
+            }
+
+            /* Control registers in address order, only the masked bits are set */
+            image->reg_addr[len] = BME68X_REG_CTRL_GAS_0;
+            image->reg_data[len] = BME68X_SET_BITS(0, BME68X_HCTRL, heatr_image.hctrl);
+            image->ctrl_mask[0] = BME68X_HCTRL_MSK;
+            len++;
+
+            image->reg_addr[len] = BME68X_REG_CTRL_GAS_1;
+            image->reg_data[len] = BME68X_SET_BITS_POS_0(0, BME68X_NBCONV, heatr_image.nb_conv);
+            image->reg_data[len] = BME68X_SET_BITS(image->reg_data[len], BME68X_RUN_GAS, heatr_image.run_gas);
+            image->reg_data[len] = BME68X_SET_BITS(image->reg_data[len], BME68X_ODR3, odr3);
+            image->ctrl_mask[1] = BME68X_NBCONV_MSK | BME68X_RUN_GAS_MSK | BME68X_ODR3_MSK;
+            len++;
+
+            image->reg_addr[len] = BME68X_REG_CTRL_HUM;
+            image->reg_data[len] = BME68X_SET_BITS_POS_0(0, BME68X_OSH, conf->os_hum);
+            image->ctrl_mask[2] = BME68X_OSH_MSK;
+            len++;
+
+            /* The image is applied in sleep mode, the measurement is started afterwards */
+            image->reg_addr[len] = BME68X_REG_CTRL_MEAS;
+            image->reg_data[len] = BME68X_SET_BITS(0, BME68X_OST, conf->os_temp);
+            image->reg_data[len] = BME68X_SET_BITS(image->reg_data[len], BME68X_OSP, conf->os_pres);
+            image->ctrl_mask[3] = BME68X_OST_MSK | BME68X_OSP_MSK | BME68X_MODE_MSK;
+            len++;
+
+            image->reg_addr[len] = BME68X_REG_CONFIG;
+            image->reg_data[len] = BME68X_SET_BITS(0, BME68X_FILTER, conf->filter);
+            image->reg_data[len] = BME68X_SET_BITS(image->reg_data[len], BME68X_ODR20, odr20);
+            image->ctrl_mask[4] = BME68X_FILTER_MSK | BME68X_ODR20_MSK;
+            len++;
+
+            image->len = len;
+            image->op_mode = op_mode;
+            image->amb_temp = heatr_image.amb_temp;
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*
+ * @brief This API writes a compiled sensor and heater configuration in one transaction.
+ */
+int8_t bme68x_set_conf_image(const struct bme68x_conf_image *image, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t reg_data[BME68X_LEN_CONF_IMAGE];
+
+    /* Register data starting from BME68X_REG_CTRL_GAS_0(0x70) up to BME68X_REG_CONFIG(0x75) */
+    uint8_t ctrl_data[BME68X_LEN_CONFIG + 1];
+    uint8_t i, len, ctrl;
+
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (image != NULL))
+    {
+        len = image->len;
+        if ((len <= BME68X_LEN_CONF_CTRL) || (len > BME68X_LEN_CONF_IMAGE))
+        {
+            rslt = BME68X_E_INVALID_LENGTH;
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            rslt = bme68x_set_op_mode(BME68X_SLEEP_MODE, dev);
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            if (ctrl_shadowed(dev))
+            {
+                for (i = 0; i < (BME68X_LEN_CONFIG + 1); i++)
+                {
+                    ctrl_data[i] = dev->shadow[BME68X_REG_CTRL_GAS_0 - BME68X_REG_IDAC_HEAT0 + i];
+                }
+            }
+            else
+            {
+                rslt = bme68x_get_regs(BME68X_REG_CTRL_GAS_0, ctrl_data, BME68X_LEN_CONFIG + 1, dev);
+            }
+        }
+
+        if (rslt == BME68X_OK)
+        {
+            for (i = 0; i < len; i++)
+            {
+                reg_data[i] = image->reg_data[i];
+            }
+
+            /* Keep the control register bits the image does not own */
+            for (i = 0; i < BME68X_LEN_CONF_CTRL; i++)
+            {
+                ctrl = len - BME68X_LEN_CONF_CTRL + i;
+                reg_data[ctrl] |= ctrl_data[image->reg_addr[ctrl] - BME68X_REG_CTRL_GAS_0] & ~image->ctrl_mask[i];
+            }
+
+            /* One burst of address and data pairs */
+            rslt = bme68x_set_regs(image->reg_addr, reg_data, len, dev);
+        }
+
+        if ((rslt == BME68X_OK) && dev->shadow_en && !dev->shadow_valid)
+        {
+            rslt = bme68x_sync_shadow(dev);
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/*!
+ * @brief This API is used to get the gas configuration of the sensor.
+ */
+int8_t bme68x_get_heatr_conf(const struct bme68x_heatr_conf *conf, struct bme68x_dev *dev)
+{
+    int8_t rslt = BME68X_OK;
+    uint8_t data_array[10] = { 0 };
+    uint8_t i;
+
+    if ((conf != NULL) && (conf->heatr_dur_prof != NULL) && (conf->heatr_temp_prof != NULL))
+    {
+        /* FIXME: Add conversion to deg C and ms and add the other parameters */
+        rslt = bme68x_get_regs(BME68X_REG_RES_HEAT0, data_array, 10, dev);
+
+        if (rslt == BME68X_OK)
+        {
+            for (i = 0; i < conf->profile_len; i++)
+            {
+                conf->heatr_temp_prof[i] = data_array[i];
             }
 
             rslt = bme68x_get_regs(BME68X_REG_GAS_WAIT0, data_array, 10, dev);
@@ -745,6 +1468,7 @@ int8_t bme68x_selftest_check(const struct bme68x_dev *dev)
         t_dev.intf = dev->intf;
         t_dev.delay_us = dev->delay_us;
         t_dev.intf_ptr = dev->intf_ptr;
+        t_dev.shadow_en = 0;
 
         rslt = bme68x_init(&t_dev);
     }
@@ -828,31 +1552,97 @@ int8_t bme68x_selftest_check(const struct bme68x_dev *dev)
     return rslt;
 }
 
+/*
+ * @brief This API performs a quick liveness and heater check of BME68X
+ */
+int8_t bme68x_selftest_quick(struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t n_fields = 0;
+    struct bme68x_data data = { 0 };
+    struct bme68x_conf conf;
+    struct bme68x_heatr_conf heatr_conf;
+
+    rslt = null_ptr_check(dev);
+    if (rslt == BME68X_OK)
+    {
+        /* Lowest oversampling, only the heater and the gas measurement matter */
+        conf.os_hum = BME68X_OS_1X;
+        conf.os_pres = BME68X_OS_1X;
+        conf.os_temp = BME68X_OS_1X;
+        conf.filter = BME68X_FILTER_OFF;
+        conf.odr = BME68X_ODR_NONE;
+        heatr_conf.enable = BME68X_ENABLE;
+        heatr_conf.heatr_dur = BME68X_HEATR_DUR_QUICK;
+        heatr_conf.heatr_temp = BME68X_HIGH_TEMP;
+        rslt = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_set_conf(&conf, dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_set_op_mode(BME68X_FORCED_MODE, dev); /* Trigger a measurement */
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        /* Wait for the measurement to complete */
+        dev->delay_us(bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, dev) + (BME68X_HEATR_DUR_QUICK * UINT32_C(1000)),
+                      dev->intf_ptr);
+        rslt = bme68x_get_data(BME68X_FORCED_MODE, &data, &n_fields, dev);
+    }
+
+    if (rslt == BME68X_W_NO_NEW_DATA)
+    {
+        rslt = BME68X_E_SELF_TEST;
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        /* The heater drew current, reached its target and the gas measurement ran */
+        if ((data.idac == 0x00) || (data.idac == 0xFF) || !(data.status & BME68X_GASM_VALID_MSK) ||
+            !(data.status & BME68X_HEAT_STAB_MSK))
+        {
+            rslt = BME68X_E_SELF_TEST;
+        }
+    }
+
+    return rslt;
+}
+
 /*****************************INTERNAL APIs***********************************************/
 #ifndef BME68X_USE_FPU
 
 /* @brief This internal API is used to calculate the temperature value. */
-static int16_t calc_temperature(uint32_t temp_adc, struct bme68x_dev *dev)
+static int16_t calc_temperature(uint32_t temp_adc, int32_t *t_fine, const struct bme68x_calib_data *calib)
 {
-    int64_t var1;
-    int64_t var2;
-    int64_t var3;
+    int32_t var1;
+    int32_t var2;
+    int32_t var3;
+    uint32_t var1_sq;
     int16_t calc_temp;
 
+    /* var1 spans 18 bits: its half squares into 32 unsigned bits and only
+     * var1 * par_t2 needs a widening multiply */
+
     /*lint -save -e701 -e702 -e704 */
-    var1 = ((int32_t)temp_adc >> 3) - ((int32_t)dev->calib.par_t1 << 1);
-    var2 = (var1 * (int32_t)dev->calib.par_t2) >> 11;
-    var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
-    var3 = ((var3) * ((int32_t)dev->calib.par_t3 << 4)) >> 14;
-    dev->calib.t_fine = (int32_t)(var2 + var3);
-    calc_temp = (int16_t)(((dev->calib.t_fine * 5) + 128) >> 8);
+    var1 = ((int32_t)temp_adc >> 3) - calib->comp.t1_x2;
+    var2 = (int32_t)(((int64_t)var1 * (int32_t)calib->par_t2) >> 11);
+    var1_sq = (uint32_t)(var1 >> 1) * (uint32_t)(var1 >> 1);
+    var3 = ((int32_t)(var1_sq >> 12) * calib->comp.t3_x16) >> 14;
+    *t_fine = var2 + var3;
+    calc_temp = (int16_t)(((*t_fine * 5) + 128) >> 8);
 
     /*lint -restore */
     return calc_temp;
 }
 
 /* @brief This internal API is used to calculate the pressure value. */
-static uint32_t calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
+static uint32_t calc_pressure(uint32_t pres_adc, int32_t t_fine, const struct bme68x_calib_data *calib)
 {
     int32_t var1;
     int32_t var2;
@@ -867,14 +1657,14 @@ static uint32_t calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
     const int32_t pres_ovf_check = INT32_C(0x40000000);
 
     /*lint -save -e701 -e702 -e713 */
-    var1 = (((int32_t)dev->calib.t_fine) >> 1) - 64000;
-    var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t)dev->calib.par_p6) >> 2;
-    var2 = var2 + ((var1 * (int32_t)dev->calib.par_p5) << 1);
-    var2 = (var2 >> 2) + ((int32_t)dev->calib.par_p4 << 16);
-    var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * ((int32_t)dev->calib.par_p3 << 5)) >> 3) +
-           (((int32_t)dev->calib.par_p2 * var1) >> 1);
+    var1 = (((int32_t)t_fine) >> 1) - 64000;
+    var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t)calib->par_p6) >> 2;
+    var2 = var2 + ((var1 * (int32_t)calib->par_p5) << 1);
+    var2 = (var2 >> 2) + calib->comp.p4_x65536;
+    var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * calib->comp.p3_x32) >> 3) +
+           (((int32_t)calib->par_p2 * var1) >> 1);
     var1 = var1 >> 18;
-    var1 = ((32768 + var1) * (int32_t)dev->calib.par_p1) >> 15;
+    var1 = ((32768 + var1) * (int32_t)calib->par_p1) >> 15;
     pressure_comp = 1048576 - pres_adc;
     pressure_comp = (int32_t)((pressure_comp - (var2 >> 12)) * ((uint32_t)3125));
     if (pressure_comp >= pres_ovf_check)
@@ -886,19 +1676,19 @@ static uint32_t calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
         pressure_comp = ((pressure_comp << 1) / var1);
     }
 
-    var1 = ((int32_t)dev->calib.par_p9 * (int32_t)(((pressure_comp >> 3) * (pressure_comp >> 3)) >> 13)) >> 12;
-    var2 = ((int32_t)(pressure_comp >> 2) * (int32_t)dev->calib.par_p8) >> 13;
+    var1 = ((int32_t)calib->par_p9 * (int32_t)(((pressure_comp >> 3) * (pressure_comp >> 3)) >> 13)) >> 12;
+    var2 = ((int32_t)(pressure_comp >> 2) * (int32_t)calib->par_p8) >> 13;
     var3 =
         ((int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) *
-         (int32_t)dev->calib.par_p10) >> 17;
-    pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 + ((int32_t)dev->calib.par_p7 << 7)) >> 4);
+         (int32_t)calib->par_p10) >> 17;
+    pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 + calib->comp.p7_x128) >> 4);
 
     /*lint -restore */
     return (uint32_t)pressure_comp;
 }
 
 /* This internal API is used to calculate the humidity in integer */
-static uint32_t calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
+static uint32_t calc_humidity(uint16_t hum_adc, int32_t t_fine, const struct bme68x_calib_data *calib)
 {
     int32_t var1;
     int32_t var2;
@@ -910,17 +1700,17 @@ static uint32_t calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
     int32_t calc_hum;
 
     /*lint -save -e702 -e704 */
-    temp_scaled = (((int32_t)dev->calib.t_fine * 5) + 128) >> 8;
-    var1 = (int32_t)(hum_adc - ((int32_t)((int32_t)dev->calib.par_h1 * 16))) -
-           (((temp_scaled * (int32_t)dev->calib.par_h3) / ((int32_t)100)) >> 1);
+    temp_scaled = (((int32_t)t_fine * 5) + 128) >> 8;
+    var1 = (int32_t)(hum_adc - calib->comp.h1_x16) -
+           (((temp_scaled * (int32_t)calib->par_h3) / ((int32_t)100)) >> 1);
     var2 =
-        ((int32_t)dev->calib.par_h2 *
-         (((temp_scaled * (int32_t)dev->calib.par_h4) / ((int32_t)100)) +
-          (((temp_scaled * ((temp_scaled * (int32_t)dev->calib.par_h5) / ((int32_t)100))) >> 6) / ((int32_t)100)) +
+        ((int32_t)calib->par_h2 *
+         (((temp_scaled * (int32_t)calib->par_h4) / ((int32_t)100)) +
+          (((temp_scaled * ((temp_scaled * (int32_t)calib->par_h5) / ((int32_t)100))) >> 6) / ((int32_t)100)) +
           (int32_t)(1 << 14))) >> 10;
     var3 = var1 * var2;
-    var4 = (int32_t)dev->calib.par_h6 << 7;
-    var4 = ((var4) + ((temp_scaled * (int32_t)dev->calib.par_h7) / ((int32_t)100))) >> 4;
+    var4 = calib->comp.h6_x128;
+    var4 = ((var4) + ((temp_scaled * (int32_t)calib->par_h7) / ((int32_t)100))) >> 4;
     var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
     var6 = (var4 * var5) >> 1;
     calc_hum = (((var3 + var6) >> 10) * ((int32_t)1000)) >> 12;
@@ -938,34 +1728,116 @@ static uint32_t calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
 }
 
 /* This internal API is used to calculate the gas resistance low */
-static uint32_t calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_dev *dev)
+static uint32_t calc_gas_resistance_low(uint16_t gas_res_adc,
+                                        uint8_t gas_range,
+                                        const struct bme68x_calib_data *calib)
 {
-    int64_t var1;
-    uint64_t var2;
-    int64_t var3;
+    uint32_t var2;
+    uint64_t var3;
     uint32_t calc_gas_res;
-    uint32_t lookup_table1[16] = {
-        UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
-        UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777), UINT32_C(2147483647), UINT32_C(2147483647),
-        UINT32_C(2143188679), UINT32_C(2136746228), UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647),
-        UINT32_C(2147483647)
-    };
-    uint32_t lookup_table2[16] = {
-        UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000), UINT32_C(512000000), UINT32_C(255744255),
-        UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064), UINT32_C(16016016), UINT32_C(8000000), UINT32_C(
-            4000000), UINT32_C(2000000), UINT32_C(1000000), UINT32_C(500000), UINT32_C(250000), UINT32_C(125000)
-    };
 
-    /*lint -save -e704 */
-    var1 = (int64_t)((1340 + (5 * (int64_t)dev->calib.range_sw_err)) * ((int64_t)lookup_table1[gas_range])) >> 16;
-    var2 = (((int64_t)((int64_t)gas_res_adc << 15) - (int64_t)(16777216)) + var1);
-    var3 = (((int64_t)lookup_table2[gas_range] * (int64_t)var1) >> 9);
-    calc_gas_res = (uint32_t)((var3 + ((int64_t)var2 >> 1)) / (int64_t)var2);
+    /* The gas range terms only depend on range_sw_err and are taken from
+     * the table built by calc_comp_data(). var2 is always within
+     * [2^24, 2^26) and the quotient fits 32 bits, so 32 bit cores can do
+     * the rounding division without a 64 bit divide. */
+    var2 = (((uint32_t)gas_res_adc << 15) - UINT32_C(16777216)) + (uint32_t)calib->comp.gas_var1[gas_range];
+    var3 = calib->comp.gas_var3[gas_range] + (var2 >> 1);
+#ifndef BME68X_DIV_U64_U32
+    calc_gas_res = (uint32_t)(var3 / var2);
+#else
+    calc_gas_res = div_u64_u32(var3, var2);
+#endif
 
-    /*lint -restore */
     return calc_gas_res;
 }
 
+#ifdef BME68X_DIV_U64_U32
+
+/* This internal API is used to divide a 64 bit value with 32 bit operations only
+ *
+ * Long division in base 2^16 on a normalized divisor (Hacker's Delight, divlu).
+ * The high word of the dividend must be lower than the divisor.
+ */
+static uint32_t div_u64_u32(uint64_t dividend, uint32_t divisor)
+{
+    const uint32_t base = UINT32_C(0x10000);
+    uint32_t u1 = (uint32_t)(dividend >> 32);
+    uint32_t u0 = (uint32_t)dividend;
+    uint32_t un32, un21, un10, un1, un0;
+    uint32_t vn1, vn0;
+    uint32_t q1, q0, rhat;
+    uint8_t shift = 0;
+
+    /* Normalize the divisor so that its MSB is set */
+    if (!(divisor & UINT32_C(0xFFFF0000)))
+    {
+        divisor <<= 16;
+        shift += 16;
+    }
+
+    if (!(divisor & UINT32_C(0xFF000000)))
+    {
+        divisor <<= 8;
+        shift += 8;
+    }
+
+    if (!(divisor & UINT32_C(0xF0000000)))
+    {
+        divisor <<= 4;
+        shift += 4;
+    }
+
+    if (!(divisor & UINT32_C(0xC0000000)))
+    {
+        divisor <<= 2;
+        shift += 2;
+    }
+
+    if (!(divisor & UINT32_C(0x80000000)))
+    {
+        divisor <<= 1;
+        shift += 1;
+    }
+
+    vn1 = divisor >> 16;
+    vn0 = divisor & UINT32_C(0xFFFF);
+    un32 = (shift == 0) ? u1 : ((u1 << shift) | (u0 >> (32 - shift)));
+    un10 = u0 << shift;
+    un1 = un10 >> 16;
+    un0 = un10 & UINT32_C(0xFFFF);
+
+    /* First quotient digit, estimated from the top half of the divisor */
+    q1 = un32 / vn1;
+    rhat = un32 - (q1 * vn1);
+    while ((q1 >= base) || ((q1 * vn0) > ((base * rhat) + un1)))
+    {
+        q1--;
+        rhat += vn1;
+        if (rhat >= base)
+        {
+            break;
+        }
+    }
+
+    un21 = ((un32 * base) + un1) - (q1 * divisor);
+
+    /* Second quotient digit */
+    q0 = un21 / vn1;
+    rhat = un21 - (q0 * vn1);
+    while ((q0 >= base) || ((q0 * vn0) > ((base * rhat) + un0)))
+    {
+        q0--;
+        rhat += vn1;
+        if (rhat >= base)
+        {
+            break;
+        }
+    }
+
+    return (q1 * base) + q0;
+}
+#endif
+
 /* This internal API is used to calculate the gas resistance */
 static uint32_t calc_gas_resistance_high(uint16_t gas_res_adc, uint8_t gas_range)
 {
@@ -1013,53 +1885,53 @@ static uint8_t calc_res_heat(uint16_t temp, const struct bme68x_dev *dev)
 #else
 
 /* @brief This internal API is used to calculate the temperature value. */
-static float calc_temperature(uint32_t temp_adc, struct bme68x_dev *dev)
+static float calc_temperature(uint32_t temp_adc, float *t_fine, const struct bme68x_calib_data *calib)
 {
     float var1;
     float var2;
     float calc_temp;
 
     /* calculate var1 data */
-    var1 = ((((float)temp_adc / 16384.0f) - ((float)dev->calib.par_t1 / 1024.0f)) * ((float)dev->calib.par_t2));
+    var1 = ((((float)temp_adc / 16384.0f) - ((float)calib->par_t1 / 1024.0f)) * ((float)calib->par_t2));
 
     /* calculate var2 data */
     var2 =
-        (((((float)temp_adc / 131072.0f) - ((float)dev->calib.par_t1 / 8192.0f)) *
-          (((float)temp_adc / 131072.0f) - ((float)dev->calib.par_t1 / 8192.0f))) * ((float)dev->calib.par_t3 * 16.0f));
+        (((((float)temp_adc / 131072.0f) - ((float)calib->par_t1 / 8192.0f)) *
+          (((float)temp_adc / 131072.0f) - ((float)calib->par_t1 / 8192.0f))) * ((float)calib->par_t3 * 16.0f));
 
     /* t_fine value*/
-    dev->calib.t_fine = (var1 + var2);
+    *t_fine = (var1 + var2);
 
     /* compensated temperature data*/
-    calc_temp = ((dev->calib.t_fine) / 5120.0f);
+    calc_temp = ((*t_fine) / 5120.0f);
 
     return calc_temp;
 }
 
 /* @brief This internal API is used to calculate the pressure value. */
-static float calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
+static float calc_pressure(uint32_t pres_adc, float t_fine, const struct bme68x_calib_data *calib)
 {
     float var1;
     float var2;
     float var3;
     float calc_pres;
 
-    var1 = (((float)dev->calib.t_fine / 2.0f) - 64000.0f);
-    var2 = var1 * var1 * (((float)dev->calib.par_p6) / (131072.0f));
-    var2 = var2 + (var1 * ((float)dev->calib.par_p5) * 2.0f);
-    var2 = (var2 / 4.0f) + (((float)dev->calib.par_p4) * 65536.0f);
-    var1 = (((((float)dev->calib.par_p3 * var1 * var1) / 16384.0f) + ((float)dev->calib.par_p2 * var1)) / 524288.0f);
-    var1 = ((1.0f + (var1 / 32768.0f)) * ((float)dev->calib.par_p1));
+    var1 = (((float)t_fine / 2.0f) - 64000.0f);
+    var2 = var1 * var1 * (((float)calib->par_p6) / (131072.0f));
+    var2 = var2 + (var1 * ((float)calib->par_p5) * 2.0f);
+    var2 = (var2 / 4.0f) + (((float)calib->par_p4) * 65536.0f);
+    var1 = (((((float)calib->par_p3 * var1 * var1) / 16384.0f) + ((float)calib->par_p2 * var1)) / 524288.0f);
+    var1 = ((1.0f + (var1 / 32768.0f)) * ((float)calib->par_p1));
     calc_pres = (1048576.0f - ((float)pres_adc));
 
     /* Avoid exception caused by division by zero */
     if ((int)var1 != 0)
     {
         calc_pres = (((calc_pres - (var2 / 4096.0f)) * 6250.0f) / var1);
-        var1 = (((float)dev->calib.par_p9) * calc_pres * calc_pres) / 2147483648.0f;
-        var2 = calc_pres * (((float)dev->calib.par_p8) / 32768.0f);
-        var3 = ((calc_pres / 256.0f) * (calc_pres / 256.0f) * (calc_pres / 256.0f) * (dev->calib.par_p10 / 131072.0f));
-        calc_pres = (calc_pres + (var1 + var2 + var3 + ((float)dev->calib.par_p7 * 128.0f)) / 16.0f);
+        var1 = (((float)calib->par_p9) * calc_pres * calc_pres) / 2147483648.0f;
+        var2 = calc_pres * (((float)calib->par_p8) / 32768.0f);
+        var3 = ((calc_pres / 256.0f) * (calc_pres / 256.0f) * (calc_pres / 256.0f) * (calib->par_p10 / 131072.0f));
+        calc_pres = (calc_pres + (var1 + var2 + var3 + ((float)calib->par_p7 * 128.0f)) / 16.0f);
     }
     else
     {
@@ -1070,7 +1942,7 @@ static float calc_pressure(uint32_t pres_adc, const struct bme68x_dev *dev)
 }
 
 /* This internal API is used to calculate the humidity in integer */
-static float calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
+static float calc_humidity(uint16_t hum_adc, float t_fine, const struct bme68x_calib_data *calib)
 {
     float calc_hum;
     float var1;
@@ -1080,15 +1952,15 @@ static float calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
     float temp_comp;
 
     /* compensated temperature data*/
-    temp_comp = ((dev->calib.t_fine) / 5120.0f);
+    temp_comp = ((t_fine) / 5120.0f);
     var1 = (float)((float)hum_adc) -
-           (((float)dev->calib.par_h1 * 16.0f) + (((float)dev->calib.par_h3 / 2.0f) * temp_comp));
+           (((float)calib->par_h1 * 16.0f) + (((float)calib->par_h3 / 2.0f) * temp_comp));
     var2 = var1 *
-           ((float)(((float)dev->calib.par_h2 / 262144.0f) *
-                    (1.0f + (((float)dev->calib.par_h4 / 16384.0f) * temp_comp) +
-                     (((float)dev->calib.par_h5 / 1048576.0f) * temp_comp * temp_comp))));
-    var3 = (float)dev->calib.par_h6 / 16384.0f;
-    var4 = (float)dev->calib.par_h7 / 2097152.0f;
+           ((float)(((float)calib->par_h2 / 262144.0f) *
+                    (1.0f + (((float)calib->par_h4 / 16384.0f) * temp_comp) +
+                     (((float)calib->par_h5 / 1048576.0f) * temp_comp * temp_comp))));
+    var3 = (float)calib->par_h6 / 16384.0f;
+    var4 = (float)calib->par_h7 / 2097152.0f;
     calc_hum = var2 + ((var3 + (var4 * temp_comp)) * var2 * var2);
     if (calc_hum > 100.0f)
     {
@@ -1103,7 +1975,7 @@ static float calc_humidity(uint16_t hum_adc, const struct bme68x_dev *dev)
 }
 
 /* This internal API is used to calculate the gas resistance low value in float */
-static float calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_dev *dev)
+static float calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_calib_data *calib)
 {
     float calc_gas_res;
     float var1;
@@ -1111,14 +1983,14 @@ static float calc_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, co
     float var3;
     float gas_res_f = gas_res_adc;
     float gas_range_f = (1U << gas_range); /*lint !e790 / Suspicious truncation, integral to float */
-    const float lookup_k1_range[16] = {
+    static const float lookup_k1_range[16] = {
         0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, -0.8f, 0.0f, 0.0f, -0.2f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f
     };
-    const float lookup_k2_range[16] = {
+    static const float lookup_k2_range[16] = {
         0.0f, 0.0f, 0.0f, 0.0f, 0.1f, 0.7f, 0.0f, -0.8f, -0.1f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f
     };
 
-    var1 = (1340.0f + (5.0f * dev->calib.range_sw_err));
+    var1 = (1340.0f + (5.0f * calib->range_sw_err));
     var2 = (var1) * (1.0f + lookup_k1_range[gas_range] / 100.0f);
     var3 = 1.0f + (lookup_k2_range[gas_range] / 100.0f);
     calc_gas_res = 1.0f / (float)(var3 * (0.000000125f) * gas_range_f * (((gas_res_f - 512.0f) / var2) + 1.0f));
@@ -1196,85 +2068,170 @@ static uint8_t calc_gas_wait(uint16_t dur)
     return durval;
 }
 
-/* This internal API is used to read a single data of the sensor */
-static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bme68x_dev *dev)
+/* This internal API is used to read the raw fields, polling at most tries times in forced mode */
+static int8_t get_raw_data(uint8_t op_mode,
+                           uint8_t tries,
+                           struct bme68x_raw_data *data,
+                           uint8_t *n_data,
+                           struct bme68x_dev *dev)
 {
-    int8_t rslt = BME68X_OK;
-    uint8_t buff[BME68X_LEN_FIELD] = { 0 };
-    uint8_t gas_range_l, gas_range_h;
-    uint32_t adc_temp;
-    uint32_t adc_pres;
-    uint16_t adc_hum;
-    uint16_t adc_gas_res_low, adc_gas_res_high;
-    uint8_t tries = 5;
+    int8_t rslt;
+    uint8_t new_fields = 0;
 
-    while ((tries) && (rslt == BME68X_OK))
+    rslt = null_ptr_check(dev);
+    if ((rslt == BME68X_OK) && (data != NULL))
     {
-        rslt = bme68x_get_regs(((uint8_t)(BME68X_REG_FIELD0 + (index * BME68X_LEN_FIELD_OFFSET))),
-                               buff,
-                               (uint16_t)BME68X_LEN_FIELD,
-                               dev);
-        if (!data)
+        /* Reading the sensor data in forced mode only */
+        if (op_mode == BME68X_FORCED_MODE)
         {
-            rslt = BME68X_E_NULL_PTR;
-            break;
+            rslt = read_field_data(0, tries, data, dev);
+            if (rslt == BME68X_OK)
+            {
+                if (data->status & BME68X_NEW_DATA_MSK)
+                {
+                    new_fields = 1;
+                }
+                else
+                {
+                    new_fields = 0;
+                    rslt = BME68X_W_NO_NEW_DATA;
+                }
+            }
         }
+        else if ((op_mode == BME68X_PARALLEL_MODE) || (op_mode == BME68X_SEQUENTIAL_MODE))
+        {
+            /* Read the 3 fields straight into their place and count the new ones */
+            rslt = read_all_field_data(data, &new_fields, dev);
 
-        data->status = buff[0] & BME68X_NEW_DATA_MSK;
-        data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
-        data->meas_index = buff[1];
+            if (new_fields == 0)
+            {
+                rslt = BME68X_W_NO_NEW_DATA;
+            }
+        }
+        else
+        {
+            rslt = BME68X_W_DEFINE_OP_MODE;
+        }
 
-        /* read the raw data from the sensor */
-        adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
-        adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
-        adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
-        adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
-        adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
-        gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
-        gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+        if (n_data == NULL)
         {
-            data->status |= buff[16] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
+            rslt = BME68X_E_NULL_PTR;
         }
         else
         {
-            data->status |= buff[14] & BME68X_GASM_VALID_MSK;
-            data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
+            *n_data = new_fields;
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to read and compensate the fields, polling at most tries times in forced mode */
+static int8_t get_data(uint8_t op_mode,
+                       uint8_t tries,
+                       struct bme68x_data *data,
+                       uint8_t *n_data,
+                       struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t i, n_fields = 0;
+    struct bme68x_raw_data raw_data[3] = { { 0 } };
+
+    if (data != NULL)
+    {
+        rslt = get_raw_data(op_mode, tries, raw_data, n_data, dev);
+        if (op_mode == BME68X_FORCED_MODE)
+        {
+            n_fields = 1;
+        }
+        else if ((op_mode == BME68X_PARALLEL_MODE) || (op_mode == BME68X_SEQUENTIAL_MODE))
+        {
+            n_fields = 3;
+        }
+
+        /* Fields that were read are compensated, a forced mode field only when it is new */
+        for (i = 0; (i < n_fields) && ((rslt == BME68X_OK) || (rslt == BME68X_W_NO_NEW_DATA)); i++)
+        {
+            if ((op_mode == BME68X_FORCED_MODE) && !(raw_data[i].status & BME68X_NEW_DATA_MSK))
+            {
+                data[i].status = raw_data[i].status;
+                data[i].gas_index = raw_data[i].gas_index;
+                data[i].meas_index = raw_data[i].meas_index;
+            }
+            else
+            {
+                compensate_field(&raw_data[i], &data[i], &dev->calib, dev->variant_id);
+            }
+        }
+    }
+    else
+    {
+        rslt = BME68X_E_NULL_PTR;
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to read a single data of the sensor */
+static int8_t read_field_data(uint8_t index, uint8_t tries, struct bme68x_raw_data *data, struct bme68x_dev *dev)
+{
+    int8_t rslt = BME68X_OK;
+
+    while ((tries) && (rslt == BME68X_OK))
+    {
+        if (!data)
+        {
+            rslt = BME68X_E_NULL_PTR;
+            break;
         }
 
+        rslt = bme68x_get_regs(((uint8_t)(BME68X_REG_FIELD0 + (index * BME68X_LEN_FIELD_OFFSET))),
+                               data->field,
+                               (uint16_t)BME68X_LEN_FIELD,
+                               dev);
+        parse_field_status(data, dev->variant_id);
+
         if ((data->status & BME68X_NEW_DATA_MSK) && (rslt == BME68X_OK))
         {
-            rslt = bme68x_get_regs(BME68X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
-            if (rslt == BME68X_OK)
+            if (ctrl_shadowed(dev))
             {
-                rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
+                /* The forced measurement is over, the sensor went back to sleep */
+                dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0] &= ~BME68X_MODE_MSK;
             }
 
-            if (rslt == BME68X_OK)
+            if ((dev->shadow_en & BME68X_SHADOW_HEATR) && dev->shadow_valid && (data->gas_index < 10))
             {
-                rslt = bme68x_get_regs(BME68X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
+                /* Heater settings as last written, the heater current is set by the sensor and read back */
+                data->res_heat = dev->shadow[10 + data->gas_index];
+                data->gas_wait = dev->shadow[20 + data->gas_index];
+                rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
             }
-
-            if (rslt == BME68X_OK)
+            else
             {
-                data->temperature = calc_temperature(adc_temp, dev);
-                data->pressure = calc_pressure(adc_pres, dev);
-                data->humidity = calc_humidity(adc_hum, dev);
-                if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+                rslt = bme68x_get_regs(BME68X_REG_RES_HEAT0 + data->gas_index, &data->res_heat, 1, dev);
+                if (rslt == BME68X_OK)
                 {
-                    data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
+                    rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0 + data->gas_index, &data->idac, 1, dev);
                 }
-                else
+
+                if (rslt == BME68X_OK)
                 {
-                    data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
+                    rslt = bme68x_get_regs(BME68X_REG_GAS_WAIT0 + data->gas_index, &data->gas_wait, 1, dev);
                 }
+            }
 
+            if (rslt == BME68X_OK)
+            {
                 break;
             }
         }
 
-        if (rslt == BME68X_OK)
+        /* No wait after the last poll */
+        if ((rslt == BME68X_OK) && (tries > 1))
         {
             dev->delay_us(BME68X_PERIOD_POLL, dev->intf_ptr);
         }
@@ -1285,31 +2242,32 @@ static int8_t read_field_data(uint8_t index, struct bme68x_data *data, struct bm
     return rslt;
 }
 
-/* This internal API is used to read all data fields of the sensor */
-static int8_t read_all_field_data(struct bme68x_data * const data[], struct bme68x_dev *dev)
+/* This internal API is used to read all data fields of the sensor in measurement order */
+static int8_t read_all_field_data(struct bme68x_raw_data *data, uint8_t *n_new, struct bme68x_dev *dev)
 {
-    int8_t rslt = BME68X_OK;
+    int8_t rslt;
     uint8_t buff[BME68X_LEN_FIELD * 3] = { 0 };
-    uint8_t gas_range_l, gas_range_h;
-    uint32_t adc_temp;
-    uint32_t adc_pres;
-    uint16_t adc_hum;
-    uint16_t adc_gas_res_low, adc_gas_res_high;
     uint8_t off;
     uint8_t set_val[30] = { 0 }; /* idac, res_heat, gas_wait */
-    uint8_t i;
+    const uint8_t *heatr_val = set_val;
+    uint8_t pos[3];
+    struct bme68x_raw_data *field;
+    uint8_t i, j;
 
-    if (!data[0] && !data[1] && !data[2])
+    *n_new = 0;
+    rslt = bme68x_get_regs(BME68X_REG_FIELD0, buff, (uint32_t) BME68X_LEN_FIELD * 3, dev);
+    if (rslt == BME68X_OK)
     {
-        rslt = BME68X_E_NULL_PTR;
+        *n_new = calc_field_order(buff, pos);
     }
 
-    if (rslt == BME68X_OK)
+    if ((rslt == BME68X_OK) && (dev->shadow_en & BME68X_SHADOW_HEATR) && dev->shadow_valid)
     {
-        rslt = bme68x_get_regs(BME68X_REG_FIELD0, buff, (uint32_t) BME68X_LEN_FIELD * 3, dev);
+        /* res_heat and gas_wait as last written, only the heater currents set by the sensor are read */
+        heatr_val = dev->shadow;
+        rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0, set_val, 10, dev);
     }
-
-    if (rslt == BME68X_OK)
+    else if (rslt == BME68X_OK)
     {
         rslt = bme68x_get_regs(BME68X_REG_IDAC_HEAT0, set_val, 30, dev);
     }
@@ -1317,50 +2275,150 @@ static int8_t read_all_field_data(struct bme68x_data * const data[], struct bme6
     for (i = 0; ((i < 3) && (rslt == BME68X_OK)); i++)
     {
         off = (uint8_t)(i * BME68X_LEN_FIELD);
-        data[i]->status = buff[off] & BME68X_NEW_DATA_MSK;
-        data[i]->gas_index = buff[off] & BME68X_GAS_INDEX_MSK;
-        data[i]->meas_index = buff[off + 1];
-
-        /* read the raw data from the sensor */
-        adc_pres =
-            (uint32_t) (((uint32_t) buff[off + 2] * 4096) | ((uint32_t) buff[off + 3] * 16) |
-                        ((uint32_t) buff[off + 4] / 16));
-        adc_temp =
-            (uint32_t) (((uint32_t) buff[off + 5] * 4096) | ((uint32_t) buff[off + 6] * 16) |
-                        ((uint32_t) buff[off + 7] / 16));
-        adc_hum = (uint16_t) (((uint32_t) buff[off + 8] * 256) | (uint32_t) buff[off + 9]);
-        adc_gas_res_low = (uint16_t) ((uint32_t) buff[off + 13] * 4 | (((uint32_t) buff[off + 14]) / 64));
-        adc_gas_res_high = (uint16_t) ((uint32_t) buff[off + 15] * 4 | (((uint32_t) buff[off + 16]) / 64));
-        gas_range_l = buff[off + 14] & BME68X_GAS_RANGE_MSK;
-        gas_range_h = buff[off + 16] & BME68X_GAS_RANGE_MSK;
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
-        {
-            data[i]->status |= buff[off + 16] & BME68X_GASM_VALID_MSK;
-            data[i]->status |= buff[off + 16] & BME68X_HEAT_STAB_MSK;
+        field = &data[pos[i]];
+        for (j = 0; j < BME68X_LEN_FIELD; j++)
+        {
+            field->field[j] = buff[off + j];
         }
-        else
+
+        parse_field_status(field, dev->variant_id);
+        field->idac = set_val[field->gas_index];
+        field->res_heat = heatr_val[10 + field->gas_index];
+        field->gas_wait = heatr_val[20 + field->gas_index];
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to compute where each of the 3 fields goes, the oldest new field first */
+static uint8_t calc_field_order(const uint8_t *buff, uint8_t *pos)
+{
+    /* Number of new fields and slot of the oldest one, by new data mask of slots 0..2 */
+    static const uint8_t n_new_lut[8] = { 0, 1, 1, 2, 1, 2, 2, 3 };
+    static const uint8_t first_lut[8] = { 0, 0, 1, 0, 2, 2, 1, 0 };
+    uint8_t idx[3];
+    uint8_t mask = 0;
+    uint8_t first, n_new, n_old;
+    uint8_t i;
+
+    for (i = 0; i < 3; i++)
+    {
+        if (buff[i * BME68X_LEN_FIELD] & BME68X_NEW_DATA_MSK)
         {
-            data[i]->status |= buff[off + 14] & BME68X_GASM_VALID_MSK;
-            data[i]->status |= buff[off + 14] & BME68X_HEAT_STAB_MSK;
+            mask |= (uint8_t)(1 << i);
         }
 
-        data[i]->idac = set_val[data[i]->gas_index];
-        data[i]->res_heat = set_val[10 + data[i]->gas_index];
-        data[i]->gas_wait = set_val[20 + data[i]->gas_index];
-        data[i]->temperature = calc_temperature(adc_temp, dev);
-        data[i]->pressure = calc_pressure(adc_pres, dev);
-        data[i]->humidity = calc_humidity(adc_hum, dev);
-        if (dev->variant_id == BME68X_VARIANT_GAS_HIGH)
+        idx[i] = buff[(i * BME68X_LEN_FIELD) + 1];
+    }
+
+    /*
+     * The sensor fills the slots in turn with an incrementing 8-bit
+     * sub-measurement index, and the new fields are the latest ones, so they
+     * follow each other in slot order. As 256 is not a multiple of 3 the index
+     * modulo 3 does not give the slot across a wrap, so with 3 new fields the
+     * oldest is the slot whose predecessor does not hold the index just before.
+     */
+    n_new = n_new_lut[mask];
+    first = first_lut[mask];
+    if (mask == 0x07)
+    {
+        if ((uint8_t)(idx[0] - idx[2]) != 1)
+        {
+            first = 0;
+        }
+        else if ((uint8_t)(idx[1] - idx[0]) != 1)
         {
-            data[i]->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
+            first = 1;
         }
         else
         {
-            data[i]->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, dev);
+            first = 2;
         }
     }
 
-    return rslt;
+    /* New fields in measurement order, then the old ones in slot order */
+    for (i = 0; i < n_new; i++)
+    {
+        pos[(first + i) % 3] = i;
+    }
+
+    n_old = n_new;
+    for (i = 0; i < 3; i++)
+    {
+        if (!(mask & (1 << i)))
+        {
+            pos[i] = n_old++;
+        }
+    }
+
+    return n_new;
+}
+
+/* This internal API is used to decode the status bytes of a field */
+static void parse_field_status(struct bme68x_raw_data *data, uint32_t variant_id)
+{
+    const uint8_t *buff = data->field;
+
+    data->status = buff[0] & BME68X_NEW_DATA_MSK;
+    data->gas_index = buff[0] & BME68X_GAS_INDEX_MSK;
+    data->meas_index = buff[1];
+    if (variant_id == BME68X_VARIANT_GAS_HIGH)
+    {
+        data->status |= buff[16] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[16] & BME68X_HEAT_STAB_MSK;
+    }
+    else
+    {
+        data->status |= buff[14] & BME68X_GASM_VALID_MSK;
+        data->status |= buff[14] & BME68X_HEAT_STAB_MSK;
+    }
+}
+
+/* This internal API is used to compensate a single raw field */
+static void compensate_field(const struct bme68x_raw_data *raw_data,
+                             struct bme68x_data *data,
+                             const struct bme68x_calib_data *calib,
+                             uint32_t variant_id)
+{
+    const uint8_t *buff = raw_data->field;
+    uint8_t gas_range_l, gas_range_h;
+    uint32_t adc_temp;
+    uint32_t adc_pres;
+    uint16_t adc_hum;
+    uint16_t adc_gas_res_low, adc_gas_res_high;
+#ifndef BME68X_USE_FPU
+    int32_t t_fine;
+#else
+    float t_fine;
+#endif
+
+    data->status = raw_data->status;
+    data->gas_index = raw_data->gas_index;
+    data->meas_index = raw_data->meas_index;
+    data->res_heat = raw_data->res_heat;
+    data->idac = raw_data->idac;
+    data->gas_wait = raw_data->gas_wait;
+
+    /* read the raw data from the sensor */
+    adc_pres = (uint32_t)(((uint32_t)buff[2] * 4096) | ((uint32_t)buff[3] * 16) | ((uint32_t)buff[4] / 16));
+    adc_temp = (uint32_t)(((uint32_t)buff[5] * 4096) | ((uint32_t)buff[6] * 16) | ((uint32_t)buff[7] / 16));
+    adc_hum = (uint16_t)(((uint32_t)buff[8] * 256) | (uint32_t)buff[9]);
+    adc_gas_res_low = (uint16_t)((uint32_t)buff[13] * 4 | (((uint32_t)buff[14]) / 64));
+    adc_gas_res_high = (uint16_t)((uint32_t)buff[15] * 4 | (((uint32_t)buff[16]) / 64));
+    gas_range_l = buff[14] & BME68X_GAS_RANGE_MSK;
+    gas_range_h = buff[16] & BME68X_GAS_RANGE_MSK;
+
+    data->temperature = calc_temperature(adc_temp, &t_fine, calib);
+    data->pressure = calc_pressure(adc_pres, t_fine, calib);
+    data->humidity = calc_humidity(adc_hum, t_fine, calib);
+    if (variant_id == BME68X_VARIANT_GAS_HIGH)
+    {
+        data->gas_resistance = calc_gas_resistance_high(adc_gas_res_high, gas_range_h);
+    }
+    else
+    {
+        data->gas_resistance = calc_gas_resistance_low(adc_gas_res_low, gas_range_l, calib);
+    }
 }
 
 /* This internal API is used to switch between SPI memory pages */
@@ -1383,24 +2441,19 @@ static int8_t set_mem_page(uint8_t reg_addr, struct bme68x_dev *dev)
             mem_page = BME68X_MEM_PAGE0;
         }
 
+        /* The page is tracked in dev->mem_page, the bus is only used to change it */
         if (mem_page != dev->mem_page)
         {
-            dev->mem_page = mem_page;
-            dev->intf_rslt = dev->read(BME68X_REG_MEM_PAGE | BME68X_SPI_RD_MSK, &reg, 1, dev->intf_ptr);
+            /* spi_mem_page is the only bit of the status register, no need to read it first */
+            reg = mem_page & BME68X_MEM_PAGE_MSK;
+            dev->intf_rslt = dev->write(BME68X_REG_MEM_PAGE & BME68X_SPI_WR_MSK, &reg, 1, dev->intf_ptr);
             if (dev->intf_rslt != 0)
             {
                 rslt = BME68X_E_COM_FAIL;
             }
-
-            if (rslt == BME68X_OK)
+            else
             {
-                reg = reg & (~BME68X_MEM_PAGE_MSK);
-                reg = reg | (dev->mem_page & BME68X_MEM_PAGE_MSK);
-                dev->intf_rslt = dev->write(BME68X_REG_MEM_PAGE & BME68X_SPI_WR_MSK, &reg, 1, dev->intf_ptr);
-                if (dev->intf_rslt != 0)
-                {
-                    rslt = BME68X_E_COM_FAIL;
-                }
+                dev->mem_page = mem_page;
             }
         }
     }
@@ -1470,73 +2523,212 @@ static int8_t null_ptr_check(const struct bme68x_dev *dev)
     return rslt;
 }
 
+/* This internal API is used to mirror written registers into the shadow */
+static void update_shadow(const uint8_t *reg_addr, const uint8_t *reg_data, uint32_t len, struct bme68x_dev *dev)
+{
+    uint32_t index;
+
+    for (index = 0; index < len; index++)
+    {
+        if ((reg_addr[index] >= BME68X_REG_IDAC_HEAT0) &&
+            (reg_addr[index] < (BME68X_REG_IDAC_HEAT0 + BME68X_LEN_SHADOW)))
+        {
+            dev->shadow[reg_addr[index] - BME68X_REG_IDAC_HEAT0] = reg_data[index];
+        }
+    }
+}
+
+/* This internal API is used to check if the control registers can be taken from the shadow */
+static uint8_t ctrl_shadowed(const struct bme68x_dev *dev)
+{
+    return (uint8_t)((dev != NULL) && (dev->shadow_en & BME68X_SHADOW_CTRL) && dev->shadow_valid);
+}
+
+/* This internal API is used to bring an asynchronous measurement to sleep mode, then trigger it */
+static int8_t async_trigger(struct bme68x_async *async, struct bme68x_dev *dev)
+{
+    int8_t rslt = BME68X_OK;
+    uint8_t reg_addr = BME68X_REG_CTRL_MEAS;
+    uint8_t pow_mode;
+
+    /*
+     * The shadow is trusted on the first step only, as in bme68x_set_op_mode(), and not for a forced
+     * measurement whose data was not read yet
+     */
+    if (ctrl_shadowed(dev) && (async->state == BME68X_ASYNC_IDLE) &&
+        ((dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0] & BME68X_MODE_MSK) != BME68X_FORCED_MODE))
+    {
+        async->ctrl_meas = dev->shadow[BME68X_REG_CTRL_MEAS - BME68X_REG_IDAC_HEAT0];
+        pow_mode = async->ctrl_meas & BME68X_MODE_MSK;
+    }
+    else
+    {
+        rslt = bme68x_get_regs(BME68X_REG_CTRL_MEAS, &async->ctrl_meas, 1, dev);
+        pow_mode = async->ctrl_meas & BME68X_MODE_MSK;
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        if (pow_mode != BME68X_SLEEP_MODE)
+        {
+            /* Put to sleep before changing mode, check again on the next step */
+            async->ctrl_meas &= ~BME68X_MODE_MSK;
+            rslt = bme68x_set_regs(&reg_addr, &async->ctrl_meas, 1, dev);
+            async->state = BME68X_ASYNC_SLEEP;
+            async->wait_us = BME68X_PERIOD_POLL;
+        }
+        else
+        {
+            async->ctrl_meas = (async->ctrl_meas & ~BME68X_MODE_MSK) | (async->op_mode & BME68X_MODE_MSK);
+            rslt = bme68x_set_regs(&reg_addr, &async->ctrl_meas, 1, dev);
+            async->state = BME68X_ASYNC_MEAS;
+            async_arm_polls(async);
+        }
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = BME68X_W_ASYNC_BUSY;
+    }
+
+    return rslt;
+}
+
+/* This internal API is used to arm the polls for new data of an asynchronous measurement */
+static void async_arm_polls(struct bme68x_async *async)
+{
+    uint32_t tries = BME68X_READ_TRIES;
+
+    /* Short polls keep the window of BME68X_READ_TRIES default ones */
+    if ((async->poll_us != 0) && (async->poll_us < BME68X_PERIOD_POLL))
+    {
+        tries = (BME68X_READ_TRIES * BME68X_PERIOD_POLL) / async->poll_us;
+        if (tries > UINT8_MAX)
+        {
+            tries = UINT8_MAX;
+        }
+    }
+
+    async->tries = (uint8_t)tries;
+    async->wait_us = async->meas_dur;
+}
+
+/* This internal API is used to end an asynchronous measurement and report it */
+static void async_done(int8_t rslt, struct bme68x_async *async)
+{
+    if ((rslt == BME68X_OK) && (async->op_mode != BME68X_FORCED_MODE))
+    {
+        /* Parallel and sequential mode keep running, the next fields are due one period later */
+        async_arm_polls(async);
+    }
+    else
+    {
+        async->state = BME68X_ASYNC_IDLE;
+        async->wait_us = 0;
+    }
+
+    if (rslt != BME68X_OK)
+    {
+        async->n_data = 0;
+    }
+
+    /* data is not written in raw mode, the callback gets no fields rather than stale ones */
+    if (async->callback != NULL)
+    {
+        if (async->raw)
+        {
+            async->callback(rslt, NULL, 0, async->cb_arg);
+        }
+        else
+        {
+            async->callback(rslt, async->data, async->n_data, async->cb_arg);
+        }
+    }
+}
+
 /* This internal API is used to set heater configurations */
 static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, uint8_t *nb_conv, struct bme68x_dev *dev)
+{
+    int8_t rslt;
+    uint8_t n_steps = 0;
+    struct bme68x_heatr_image image;
+
+    rslt = calc_heatr_regs(conf, op_mode, &image, &n_steps, dev);
+    if ((rslt == BME68X_OK) && (op_mode == BME68X_PARALLEL_MODE))
+    {
+        rslt = bme68x_set_regs(&image.reg_addr[2 * n_steps], &image.reg_data[2 * n_steps], 1, dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_set_regs(image.reg_addr, image.reg_data, n_steps, dev);
+    }
+
+    if (rslt == BME68X_OK)
+    {
+        rslt = bme68x_set_regs(&image.reg_addr[n_steps], &image.reg_data[n_steps], n_steps, dev);
+    }
+
+    (*nb_conv) = (op_mode == BME68X_FORCED_MODE) ? 0 : n_steps;
+
+    return rslt;
+}
+
+/* This internal API is used to calculate the res_heat, gas_wait and shared duration registers */
+static int8_t calc_heatr_regs(const struct bme68x_heatr_conf *conf,
+                              uint8_t op_mode,
+                              struct bme68x_heatr_image *image,
+                              uint8_t *n_steps,
+                              const struct bme68x_dev *dev)
 {
     int8_t rslt = BME68X_OK;
     uint8_t i;
-    uint8_t shared_dur;
-    uint8_t write_len = 0;
-    uint8_t heater_dur_shared_addr = BME68X_REG_SHD_HEATR_DUR;
-    uint8_t rh_reg_addr[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-    uint8_t rh_reg_data[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-    uint8_t gw_reg_addr[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-    uint8_t gw_reg_data[10] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    uint8_t len = 0;
 
+    /* res_heat of every step first, then gas_wait, then the shared duration */
     switch (op_mode)
     {
         case BME68X_FORCED_MODE:
-            rh_reg_addr[0] = BME68X_REG_RES_HEAT0;
-            rh_reg_data[0] = calc_res_heat(conf->heatr_temp, dev);
-            gw_reg_addr[0] = BME68X_REG_GAS_WAIT0;
-            gw_reg_data[0] = calc_gas_wait(conf->heatr_dur);
-            (*nb_conv) = 0;
-            write_len = 1;
+            image->reg_addr[0] = BME68X_REG_RES_HEAT0;
+            image->reg_data[0] = calc_res_heat(conf->heatr_temp, dev);
+            image->reg_addr[1] = BME68X_REG_GAS_WAIT0;
+            image->reg_data[1] = calc_gas_wait(conf->heatr_dur);
+            len = 1;
             break;
         case BME68X_SEQUENTIAL_MODE:
+        case BME68X_PARALLEL_MODE:
             if ((!conf->heatr_dur_prof) || (!conf->heatr_temp_prof))
             {
                 rslt = BME68X_E_NULL_PTR;
                 break;
             }
 
-            for (i = 0; i < conf->profile_len; i++)
-            {
-                rh_reg_addr[i] = BME68X_REG_RES_HEAT0 + i;
-                rh_reg_data[i] = calc_res_heat(conf->heatr_temp_prof[i], dev);
-                gw_reg_addr[i] = BME68X_REG_GAS_WAIT0 + i;
-                gw_reg_data[i] = calc_gas_wait(conf->heatr_dur_prof[i]);
-            }
-
-            (*nb_conv) = conf->profile_len;
-            write_len = conf->profile_len;
-            break;
-        case BME68X_PARALLEL_MODE:
-            if ((!conf->heatr_dur_prof) || (!conf->heatr_temp_prof))
+            if (conf->profile_len > 10)
             {
-                rslt = BME68X_E_NULL_PTR;
+                rslt = BME68X_E_INVALID_LENGTH;
                 break;
             }
 
-            if (conf->shared_heatr_dur == 0)
+            if ((op_mode == BME68X_PARALLEL_MODE) && (conf->shared_heatr_dur == 0))
             {
                 rslt = BME68X_W_DEFINE_SHD_HEATR_DUR;
             }
 
-            for (i = 0; i < conf->profile_len; i++)
-            {
-                rh_reg_addr[i] = BME68X_REG_RES_HEAT0 + i;
-                rh_reg_data[i] = calc_res_heat(conf->heatr_temp_prof[i], dev);
-                gw_reg_addr[i] = BME68X_REG_GAS_WAIT0 + i;
-                gw_reg_data[i] = (uint8_t) conf->heatr_dur_prof[i];
-            }
-
-            (*nb_conv) = conf->profile_len;
-            write_len = conf->profile_len;
-            shared_dur = calc_heatr_dur_shared(conf->shared_heatr_dur);
-            if (rslt == BME68X_OK)
+            len = conf->profile_len;
+            for (i = 0; i < len; i++)
             {
-                rslt = bme68x_set_regs(&heater_dur_shared_addr, &shared_dur, 1, dev);
+                image->reg_addr[i] = BME68X_REG_RES_HEAT0 + i;
+                image->reg_data[i] = calc_res_heat(conf->heatr_temp_prof[i], dev);
+                image->reg_addr[len + i] = BME68X_REG_GAS_WAIT0 + i;
+                if (op_mode == BME68X_SEQUENTIAL_MODE)
+                {
+                    image->reg_data[len + i] = calc_gas_wait(conf->heatr_dur_prof[i]);
+                }
+                else
+                {
+                    /* Multiples of the shared heater duration in parallel mode */
+                    image->reg_data[len + i] = (uint8_t) conf->heatr_dur_prof[i];
+                }
             }
 
             break;
@@ -1544,19 +2736,41 @@ static int8_t set_conf(const struct bme68x_heatr_conf *conf, uint8_t op_mode, ui
             rslt = BME68X_W_DEFINE_OP_MODE;
     }
 
-    if (rslt == BME68X_OK)
+    image->len = (uint8_t)(2 * len);
+    if (op_mode == BME68X_PARALLEL_MODE)
     {
-        rslt = bme68x_set_regs(rh_reg_addr, rh_reg_data, write_len, dev);
+        image->reg_addr[image->len] = BME68X_REG_SHD_HEATR_DUR;
+        image->reg_data[image->len] = calc_heatr_dur_shared(conf->shared_heatr_dur);
+        image->len++;
     }
 
-    if (rslt == BME68X_OK)
-    {
-        rslt = bme68x_set_regs(gw_reg_addr, gw_reg_data, write_len, dev);
-    }
+    *n_steps = len;
 
     return rslt;
 }
 
+/* This internal API is used to select the heater control and run_gas bits */
+static void calc_gas_ctrl(uint8_t enable, uint32_t variant_id, uint8_t *hctrl, uint8_t *run_gas)
+{
+    if (enable == BME68X_ENABLE)
+    {
+        *hctrl = BME68X_ENABLE_HEATER;
+        if (variant_id == BME68X_VARIANT_GAS_HIGH)
+        {
+            *run_gas = BME68X_ENABLE_GAS_MEAS_H;
+        }
+        else
+        {
+            *run_gas = BME68X_ENABLE_GAS_MEAS_L;
+        }
+    }
+    else
+    {
+        *hctrl = BME68X_DISABLE_HEATER;
+        *run_gas = BME68X_DISABLE_GAS_MEAS;
+    }
+}
+
 /* This internal API is used to calculate the register value for
  * shared heater duration */
 static uint8_t calc_heatr_dur_shared(uint16_t dur)
@@ -1584,139 +2798,6 @@ static uint8_t calc_heatr_dur_shared(uint16_t dur)
     return heatdurval;
 }
 
-/* This internal API is used sort the sensor data */
-static void sort_sensor_data(uint8_t low_index, uint8_t high_index, struct bme68x_data *field[])
-{
-    int16_t meas_index1;
-    int16_t meas_index2;
-
-    meas_index1 = (int16_t)field[low_index]->meas_index;
-    meas_index2 = (int16_t)field[high_index]->meas_index;
-    if ((field[low_index]->status & BME68X_NEW_DATA_MSK) && (field[high_index]->status & BME68X_NEW_DATA_MSK))
-    {
-        int16_t diff = meas_index2 - meas_index1;
-        if (((diff > -3) && (diff < 0)) || (diff > 2))
-        {
-            swap_fields(low_index, high_index, field);
-        }
-    }
-    else if (field[high_index]->status & BME68X_NEW_DATA_MSK)
-    {
-        swap_fields(low_index, high_index, field);
-    }
-
-    /* Sorting field data
-     *
-     * The 3 fields are filled in a fixed order with data in an incrementing
-     * 8-bit sub-measurement index which looks like
-     * Field index | Sub-meas index
-     *      0      |        0
-     *      1      |        1
-     *      2      |        2
-     *      0      |        3
-     *      1      |        4
-     *      2      |        5
-     *      ...
-     *      0      |        252
-     *      1      |        253
-     *      2      |        254
-     *      0      |        255
-     *      1      |        0
-     *      2      |        1
-     *
-     * The fields are sorted in a way so as to always deal with only a snapshot
-     * of comparing 2 fields at a time. The order being
-     * field0 & field1
-     * field0 & field2
-     * field1 & field2
-     * Here the oldest data should be in field0 while the newest is in field2.
-     * In the following documentation, field0's position would referred to as
-     * the lowest and field2 as the highest.
-     *
-     * In order to sort we have to consider the following cases,
-     *
-     * Case A: No fields have new data
-     *     Then do not sort, as this data has already been read.
-     *
-     * Case B: Higher field has new data
-     *     Then the new field get's the lowest position.
-     *
-     * Case C: Both fields have new data
-     *     We have to put the oldest sample in the lowest position. Since the
-     *     sub-meas index contains in essence the age of the sample, we calculate
-     *     the difference between the higher field and the lower field.
-     *     Here we have 3 sub-cases,
-     *     Case 1: Regular read without overwrite
-     *         Field index | Sub-meas index
-     *              0      |        3
-     *              1      |        4
-     *
-     *         Field index | Sub-meas index
-     *              0      |        3
-     *              2      |        5
-     *
-     *         The difference is always <= 2. There is no need to swap as the
-     *         oldest sample is already in the lowest position.
-     *
-     *     Case 2: Regular read with an overflow and without an overwrite
-     *         Field index | Sub-meas index
-     *              0      |        255
-     *              1      |        0
-     *
-     *         Field index | Sub-meas index
-     *              0      |        254
-     *              2      |        0
-     *
-     *         The difference is always <= -3. There is no need to swap as the
-     *         oldest sample is already in the lowest position.
-     *
-     *     Case 3: Regular read with overwrite
-     *         Field index | Sub-meas index
-     *              0      |        6
-     *              1      |        4
-     *
-     *         Field index | Sub-meas index
-     *              0      |        6
-     *              2      |        5
-     *
-     *         The difference is always > -3. There is a need to swap as the
-     *         oldest sample is not in the lowest position.
-     *
-     *     Case 4: Regular read with overwrite and overflow
-     *         Field index | Sub-meas index
-     *              0      |        0
-     *              1      |        254
-     *
-     *         Field index | Sub-meas index
-     *              0      |        0
-     *              2      |        255
-     *
-     *         The difference is always > 2. There is a need to swap as the
-     *         oldest sample is not in the lowest position.
-     *
-     * To summarize, we have to swap when
-     *     - The higher field has new data and the lower field does not.
-     *     - If both fields have new data, then the difference of sub-meas index
-     *         between the higher field and the lower field creates the
-     *         following condition for swapping.
-     *         - (diff > -3) && (diff < 0), combination of cases 1, 2, and 3.
-     *         - diff > 2, case 4.
-     *
-     *     Here the limits of -3 and 2 derive from the fact that there are 3 fields.
-     *     These values decrease or increase respectively if the number of fields increases.
-     */
-}
-
-/* This internal API is used sort the sensor data */
-static void swap_fields(uint8_t index1, uint8_t index2, struct bme68x_data *field[])
-{
-    struct bme68x_data *temp;
-
-    temp = field[index1];
-    field[index1] = field[index2];
-    field[index2] = temp;
-}
-
 /* This Function is to analyze the sensor data */
 static int8_t analyze_sensor_data(const struct bme68x_data *data, uint8_t n_meas)
 {
@@ -1834,11 +2915,55 @@ static int8_t get_calib_data(struct bme68x_dev *dev)
         dev->calib.res_heat_range = ((coeff_array[BME68X_IDX_RES_HEAT_RANGE] & BME68X_RHRANGE_MSK) / 16);
         dev->calib.res_heat_val = (int8_t)coeff_array[BME68X_IDX_RES_HEAT_VAL];
         dev->calib.range_sw_err = ((int8_t)(coeff_array[BME68X_IDX_RANGE_SW_ERR] & BME68X_RSERROR_MSK)) / 16;
+
+#ifndef BME68X_USE_FPU
+        calc_comp_data(&dev->calib);
+#endif
     }
 
     return rslt;
 }
 
+#ifndef BME68X_USE_FPU
+
+/* This internal API is used to derive the calibration-only compensation terms */
+static void calc_comp_data(struct bme68x_calib_data *calib)
+{
+    static const uint32_t lookup_table1[16] = {
+        UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
+        UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777), UINT32_C(2147483647), UINT32_C(2147483647),
+        UINT32_C(2143188679), UINT32_C(2136746228), UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647),
+        UINT32_C(2147483647)
+    };
+    static const uint32_t lookup_table2[16] = {
+        UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000), UINT32_C(512000000), UINT32_C(255744255),
+        UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064), UINT32_C(16016016), UINT32_C(8000000), UINT32_C(
+            4000000), UINT32_C(2000000), UINT32_C(1000000), UINT32_C(500000), UINT32_C(250000), UINT32_C(125000)
+    };
+    int64_t var1;
+    uint8_t i;
+
+    /*lint -save -e701 -e704 */
+    for (i = 0; i < 16; i++)
+    {
+        /* Gas resistance low terms that only depend on the gas range */
+        var1 = (int64_t)((1340 + (5 * (int64_t)calib->range_sw_err)) * ((int64_t)lookup_table1[i])) >> 16;
+        calib->comp.gas_var1[i] = (int32_t)var1;
+        calib->comp.gas_var3[i] = (uint64_t)(((int64_t)lookup_table2[i] * var1) >> 9);
+    }
+
+    calib->comp.t1_x2 = (int32_t)calib->par_t1 << 1;
+    calib->comp.t3_x16 = (int32_t)calib->par_t3 << 4;
+    calib->comp.p3_x32 = (int32_t)calib->par_p3 << 5;
+    calib->comp.p4_x65536 = (int32_t)calib->par_p4 << 16;
+    calib->comp.p7_x128 = (int32_t)calib->par_p7 << 7;
+    calib->comp.h1_x16 = (int32_t)calib->par_h1 * 16;
+    calib->comp.h6_x128 = (int32_t)calib->par_h6 << 7;
+
+    /*lint -restore */
+}
+#endif
+
 /* This internal API is used to read variant ID information from the register */
 static int8_t read_variant_id(struct bme68x_dev *dev)
 {
@@ -1854,4 +2979,26 @@ static int8_t read_variant_id(struct bme68x_dev *dev)
     }
 
     return rslt;
+}
+
+/* This internal API is used to calculate the CRC of a calibration cache */
+static uint16_t calc_cache_crc(const struct bme68x_calib_cache *cache)
+{
+    /* CRC-16/CCITT over everything after the crc member */
+    const uint8_t *bytes = (const uint8_t *)cache + sizeof(cache->crc);
+    uint16_t len = sizeof(*cache) - sizeof(cache->crc);
+    uint16_t crc = UINT16_C(0xffff);
+    uint16_t i;
+    uint8_t bit;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)bytes[i] << 8;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
 }
\ No newline at end of file
@@ -76,6 +76,51 @@ extern "C" {
  */
 int8_t bme68x_init(struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiInit
+ * \page bme68x_api_bme68x_init_cached bme68x_init_cached
+ * \code
+ * int8_t bme68x_init_cached(const struct bme68x_calib_cache *cache, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API is a fast alternative to bme68x_init() for warm boots.
+ * It takes the calibration data from a cache saved by
+ * bme68x_get_calib_cache() instead of resetting the sensor and reading the
+ * coefficients. Only the chip-id and the COEFF2 up to VARIANT_ID registers
+ * are read to check the cache still belongs to the connected sensor. The
+ * sensor keeps its previous configuration and operation mode; apply the
+ * configuration again before measuring. Fall back to bme68x_init() when
+ * this API fails.
+ *
+ * @param[in] cache   : Calibration cache of this sensor.
+ * @param[in,out] dev : Structure instance of bme68x_dev
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval BME68X_E_CALIB_CACHE -> Cache corrupt, from another build or another sensor
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_init_cached(const struct bme68x_calib_cache *cache, struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiInit
+ * \page bme68x_api_bme68x_get_calib_cache bme68x_get_calib_cache
+ * \code
+ * int8_t bme68x_get_calib_cache(struct bme68x_calib_cache *cache, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API saves the calibration data of a device initialized with
+ * bme68x_init(), with the identity of the sensor and a CRC, for a later
+ * bme68x_init_cached(). The cache is plain data and can be kept in retained
+ * RAM or non-volatile storage as is.
+ *
+ * @param[out] cache  : Calibration cache.
+ * @param[in,out] dev : Structure instance of bme68x_dev
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_get_calib_cache(struct bme68x_calib_cache *cache, struct bme68x_dev *dev);
+
 /**
  * \ingroup bme68x
  * \defgroup bme68xApiRegister Registers
@@ -143,6 +188,25 @@ int8_t bme68x_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, struct
  */
 int8_t bme68x_soft_reset(struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiSystem
+ * \page bme68x_api_bme68x_sync_shadow bme68x_sync_shadow
+ * \code
+ * int8_t bme68x_sync_shadow(struct bme68x_dev *dev);
+ * \endcode
+ * @details This API refills the register shadow (IDAC_HEAT_0 up to CONFIG)
+ * from the sensor in one burst read. bme68x_init() calls it when
+ * dev->shadow_en is set; call it again after a communication error or
+ * after a soft reset issued outside of bme68x_init().
+ *
+ * @param[in,out] dev : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_sync_shadow(struct bme68x_dev *dev);
+
 /**
  * \ingroup bme68x
  * \defgroup bme68xApiOm Operation mode
@@ -225,6 +289,173 @@ uint32_t bme68x_get_meas_dur(const uint8_t op_mode, struct bme68x_conf *conf, st
  */
 int8_t bme68x_get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_data, struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiData
+ * \page bme68x_api_bme68x_get_raw_data bme68x_get_raw_data
+ * \code
+ * int8_t bme68x_get_raw_data(uint8_t op_mode, struct bme68x_raw_data *data, uint8_t *n_data, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API reads the field registers of the sensor without
+ * compensating them. Status, gas index, measurement index and heater settings
+ * are decoded; the field bytes are kept as read so that compensation can be
+ * done later, e.g. by a lower priority task, with bme68x_compensate_raw().
+ * Fields are returned in the same order as with bme68x_get_data().
+ *
+ * @param[in]  op_mode : Expected operation mode.
+ * @param[out] data    : Structure instance(s) to hold the raw fields,
+ *                       3 for parallel and sequential mode.
+ * @param[out] n_data  : Number of new fields available.
+ * @param[in,out] dev  : Structure instance of bme68x_dev
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_get_raw_data(uint8_t op_mode, struct bme68x_raw_data *data, uint8_t *n_data, struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiData
+ * \page bme68x_api_bme68x_compensate_raw bme68x_compensate_raw
+ * \code
+ * int8_t bme68x_compensate_raw(const struct bme68x_raw_data *raw_data,
+ *                              uint8_t n_data,
+ *                              struct bme68x_data *data,
+ *                              const struct bme68x_calib_data *calib,
+ *                              uint32_t variant_id);
+ * \endcode
+ * @details This API compensates fields read with bme68x_get_raw_data(). It
+ * does not access the bus and only needs a copy of the calibration data and
+ * the variant id of the sensor the fields were read from.
+ *
+ * @param[in]  raw_data   : Raw fields to compensate.
+ * @param[in]  n_data     : Number of fields.
+ * @param[out] data       : Compensated data, n_data instances.
+ * @param[in]  calib      : Calibration data of the sensor (dev->calib).
+ * @param[in]  variant_id : Variant id of the sensor (dev->variant_id).
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_compensate_raw(const struct bme68x_raw_data *raw_data,
+                             uint8_t n_data,
+                             struct bme68x_data *data,
+                             const struct bme68x_calib_data *calib,
+                             uint32_t variant_id);
+
+/*!
+ * \ingroup bme68xApiData
+ * \page bme68x_api_bme68x_compensate_batch bme68x_compensate_batch
+ * \code
+ * int8_t bme68x_compensate_batch(const struct bme68x_raw_batch *raw,
+ *                                struct bme68x_data_batch *data,
+ *                                uint32_t n_data,
+ *                                const struct bme68x_calib_data *calib,
+ *                                uint32_t variant_id);
+ * \endcode
+ * @details This API compensates a batch of raw ADC values given as one array
+ * per quantity. Samples are processed in chunks of BME68X_BATCH_CHUNK, one
+ * pass per quantity, so that the loops carry no dependency between samples.
+ * Results are the same as with bme68x_compensate_raw(). Pressure, humidity
+ * and gas are skipped when their input array is NULL.
+ *
+ * @param[in]  raw        : Raw ADC values, n_data entries per array.
+ * @param[out] data       : Compensated values, n_data entries per array in use.
+ * @param[in]  n_data     : Number of samples.
+ * @param[in]  calib      : Calibration data of the sensor (dev->calib).
+ * @param[in]  variant_id : Variant id of the sensor (dev->variant_id).
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_compensate_batch(const struct bme68x_raw_batch *raw,
+                               struct bme68x_data_batch *data,
+                               uint32_t n_data,
+                               const struct bme68x_calib_data *calib,
+                               uint32_t variant_id);
+
+/**
+ * \ingroup bme68x
+ * \defgroup bme68xApiAsync Asynchronous measurement
+ * @brief Measurement API that never waits inside the driver
+ */
+
+/*!
+ * \ingroup bme68xApiAsync
+ * \page bme68x_api_bme68x_async_start bme68x_async_start
+ * \code
+ * int8_t bme68x_async_start(uint8_t op_mode, uint32_t meas_dur, struct bme68x_async *async, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API starts a measurement without calling dev->delay_us.
+ * Instead of spinning until the sensor is in sleep mode and polling for new
+ * data, the driver returns BME68X_W_ASYNC_BUSY and sets async->wait_us. The
+ * caller's scheduler then calls bme68x_async_step() once that time has
+ * passed, until the step returns something else. async->callback,
+ * async->cb_arg and async->poll_us are set by the caller before starting.
+ *
+ * In parallel and sequential mode the measurement keeps running: every
+ * completed step reports new fields and schedules the next read one
+ * meas_dur later, until bme68x_async_stop().
+ *
+ * @param[in] op_mode   : Forced, parallel or sequential mode.
+ * @param[in] meas_dur  : Time in microseconds from the trigger to the
+ *                        first read, TPH plus heating duration.
+ * @param[in,out] async : Measurement state.
+ * @param[in,out] dev   : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval BME68X_W_ASYNC_BUSY -> Started, step again after async->wait_us
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_async_start(uint8_t op_mode, uint32_t meas_dur, struct bme68x_async *async, struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiAsync
+ * \page bme68x_api_bme68x_async_step bme68x_async_step
+ * \code
+ * int8_t bme68x_async_step(struct bme68x_async *async, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API advances a measurement started with bme68x_async_start()
+ * by at most one read and one write. When the measurement is done, the
+ * fields are in async->data (async->raw_data, uncompensated, with
+ * async->raw set), the callback is called and the result of the read is
+ * returned. Up to BME68X_READ_TRIES polls are made for new data,
+ * BME68X_PERIOD_POLL apart, before the step reports BME68X_W_NO_NEW_DATA.
+ * With async->poll_us set, the polls are that far apart instead and their
+ * number grows so that they cover the same time.
+ * Does nothing when no measurement is running.
+ *
+ * @param[in,out] async : Measurement state.
+ * @param[in,out] dev   : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval BME68X_W_ASYNC_BUSY -> Running, step again after async->wait_us
+ * @retval 0 -> Success, new fields in async->data
+ * @retval > 0 -> Warning, as returned by bme68x_get_data()
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_async_step(struct bme68x_async *async, struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiAsync
+ * \page bme68x_api_bme68x_async_stop bme68x_async_stop
+ * \code
+ * int8_t bme68x_async_stop(struct bme68x_async *async, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API ends an asynchronous measurement and writes sleep mode
+ * once, without waiting for the sensor to get there. The next
+ * bme68x_async_start() checks it.
+ *
+ * @param[in,out] async : Measurement state.
+ * @param[in,out] dev   : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_async_stop(struct bme68x_async *async, struct bme68x_dev *dev);
+
 /**
  * \ingroup bme68x
  * \defgroup bme68xApiConfig Configuration
@@ -284,6 +515,111 @@ int8_t bme68x_get_conf(struct bme68x_conf *conf, struct bme68x_dev *dev);
  */
 int8_t bme68x_set_heatr_conf(uint8_t op_mode, const struct bme68x_heatr_conf *conf, struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiConfig
+ * \page bme68x_api_bme68x_compile_heatr_conf bme68x_compile_heatr_conf
+ * \code
+ * int8_t bme68x_compile_heatr_conf(uint8_t op_mode,
+ *                                  const struct bme68x_heatr_conf *conf,
+ *                                  struct bme68x_heatr_image *image,
+ *                                  const struct bme68x_dev *dev);
+ * \endcode
+ * @details This API computes the heater registers of a gas configuration
+ * once, without accessing the sensor. The image only depends on the
+ * calibration data and dev->amb_temp, which is recorded in image->amb_temp;
+ * compile again when the ambient temperature changes. Keep one image per
+ * heater profile and switch between them with bme68x_set_heatr_image().
+ *
+ * @param[in] op_mode : Operation mode the profile is for.
+ * @param[in] conf    : Heating configuration, as for bme68x_set_heatr_conf().
+ * @param[out] image  : Compiled register image.
+ * @param[in] dev     : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_compile_heatr_conf(uint8_t op_mode,
+                                 const struct bme68x_heatr_conf *conf,
+                                 struct bme68x_heatr_image *image,
+                                 const struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiConfig
+ * \page bme68x_api_bme68x_set_heatr_image bme68x_set_heatr_image
+ * \code
+ * int8_t bme68x_set_heatr_image(const struct bme68x_heatr_image *image, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API puts the sensor to sleep and writes a heater image from
+ * bme68x_compile_heatr_conf() in a single burst. The result is the same as
+ * bme68x_set_heatr_conf() with the configuration the image was compiled
+ * from. With BME68X_SHADOW_CTRL the switch costs one write, otherwise
+ * CTRL_GAS_0/1 are read back first.
+ *
+ * @param[in] image   : Compiled heater configuration.
+ * @param[in,out] dev : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_set_heatr_image(const struct bme68x_heatr_image *image, struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiConfig
+ * \page bme68x_api_bme68x_compile_conf bme68x_compile_conf
+ * \code
+ * int8_t bme68x_compile_conf(uint8_t op_mode,
+ *                            struct bme68x_conf *conf,
+ *                            const struct bme68x_heatr_conf *heatr_conf,
+ *                            struct bme68x_conf_image *image,
+ *                            struct bme68x_dev *dev);
+ * \endcode
+ * @details This API validates a sensor configuration and a heater
+ * configuration once and compiles both to one register image, without
+ * accessing the sensor. Out of range settings are limited as in
+ * bme68x_set_conf() and reported in dev->info_msg. Like a heater image,
+ * the result depends on dev->amb_temp.
+ *
+ * @param[in] op_mode       : Operation mode the configuration is for.
+ * @param[in,out] conf      : Oversampling, filter and odr settings.
+ * @param[in] heatr_conf    : Heating configuration, as for bme68x_set_heatr_conf().
+ * @param[out] image        : Compiled register image.
+ * @param[in,out] dev       : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_compile_conf(uint8_t op_mode,
+                           struct bme68x_conf *conf,
+                           const struct bme68x_heatr_conf *heatr_conf,
+                           struct bme68x_conf_image *image,
+                           struct bme68x_dev *dev);
+
+/*!
+ * \ingroup bme68xApiConfig
+ * \page bme68x_api_bme68x_set_conf_image bme68x_set_conf_image
+ * \code
+ * int8_t bme68x_set_conf_image(const struct bme68x_conf_image *image, struct bme68x_dev *dev);
+ * \endcode
+ * @details This API puts the sensor to sleep and writes an image from
+ * bme68x_compile_conf() with one bme68x_set_regs() call. The registers end
+ * up as after bme68x_set_conf() and bme68x_set_heatr_conf(), except that the
+ * sensor is left in sleep mode; start the measurement with
+ * bme68x_set_op_mode() or bme68x_async_start(). Control register bits the
+ * image does not own are taken from the shadow, or read back in one burst
+ * when BME68X_SHADOW_CTRL is not enabled.
+ *
+ * @param[in] image   : Compiled sensor and heater configuration.
+ * @param[in,out] dev : Structure instance of bme68x_dev.
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_set_conf_image(const struct bme68x_conf_image *image, struct bme68x_dev *dev);
+
 /*!
  * \ingroup bme68xApiConfig
  * \page bme68x_api_bme68x_get_heatr_conf bme68x_get_heatr_conf
@@ -308,6 +644,9 @@ int8_t bme68x_get_heatr_conf(const struct bme68x_heatr_conf *conf, struct bme68x
  * int8_t bme68x_selftest_check(const struct bme68x_dev *dev);
  * \endcode
  * @details This API performs Self-test of low gas variant of BME68X
+ * It resets the sensor and runs for about 13 s; with a shared device
+ * structure, call bme68x_sync_shadow() and configure the sensor again
+ * afterwards. Refer bme68x_selftest_quick() for a check at boot.
  *
  * @param[in, out]   dev  : Structure instance of bme68x_dev
  *
@@ -317,6 +656,27 @@ int8_t bme68x_get_heatr_conf(const struct bme68x_heatr_conf *conf, struct bme68x
  */
 int8_t bme68x_selftest_check(const struct bme68x_dev *dev);
 
+/*!
+ * \ingroup bme68xApiSystem
+ * \page bme68x_api_bme68x_selftest_quick bme68x_selftest_quick
+ * \code
+ * int8_t bme68x_selftest_quick(struct bme68x_dev *dev);
+ * \endcode
+ * @details This API performs a quick check of an initialized BME68X: one
+ * forced measurement with a BME68X_HEATR_DUR_QUICK ms heater step, which
+ * must report a heater current, a stable heater and a valid gas
+ * measurement. It takes about 110 ms instead of the seconds of
+ * bme68x_selftest_check() and does not reset the sensor. The sensor
+ * configuration is overwritten; configure the sensor again afterwards.
+ *
+ * @param[in,out] dev : Structure instance of bme68x_dev
+ *
+ * @return Result of API execution status
+ * @retval 0 -> Success
+ * @retval < 0 -> Fail
+ */
+int8_t bme68x_selftest_quick(struct bme68x_dev *dev);
+
 #ifdef __cplusplus
 }
 #endif /* End of CPP guard */
@@ -132,6 +132,9 @@
 /* Self test fail error */
 #define BME68X_E_SELF_TEST                        INT8_C(-5)
 
+/* Calibration cache corrupt or from another sensor */
+#define BME68X_E_CALIB_CACHE                      INT8_C(-6)
+
 /* Warnings */
 /* Define a valid operation mode */
 #define BME68X_W_DEFINE_OP_MODE                   INT8_C(1)
@@ -142,6 +145,9 @@
 /* Define the shared heating duration */
 #define BME68X_W_DEFINE_SHD_HEATR_DUR             INT8_C(3)
 
+/* Asynchronous measurement still running, step again after wait_us */
+#define BME68X_W_ASYNC_BUSY                       INT8_C(4)
+
 /* Information - only available via bme68x_dev.info_msg */
 #define BME68X_I_PARAM_CORR                       UINT8_C(1)
 
@@ -305,6 +311,36 @@
 /* Sequential operation mode */
 #define BME68X_SEQUENTIAL_MODE                    UINT8_C(3)
 
+/* Register shadow macros */
+
+/*
+ * Take res_heat and gas_wait of a new field from the shadow instead of
+ * reading them back, so a forced mode read is 2 transactions instead of 4.
+ * idac is set by the sensor and is always read back
+ */
+#define BME68X_SHADOW_HEATR                       UINT8_C(0x01)
+
+/*
+ * Take CTRL_GAS_0 up to CONFIG from the shadow, so mode changes and
+ * configuration updates become pure writes. A forced measurement counts as
+ * running until its new data was read, until then the mode is read back
+ */
+#define BME68X_SHADOW_CTRL                        UINT8_C(0x02)
+
+/* Asynchronous measurement state macros */
+
+/* No measurement running */
+#define BME68X_ASYNC_IDLE                         UINT8_C(0)
+
+/* Waiting for the sensor to reach sleep mode */
+#define BME68X_ASYNC_SLEEP                        UINT8_C(1)
+
+/* Measurement running, waiting for new data */
+#define BME68X_ASYNC_MEAS                         UINT8_C(2)
+
+/* Number of polls for new data before a read gives up */
+#define BME68X_READ_TRIES                         UINT8_C(5)
+
 /* SPI page macros */
 
 /* SPI memory page 0 */
@@ -327,6 +363,16 @@
 /* Length for 3rd group of coefficients */
 #define BME68X_LEN_COEFF3                         UINT8_C(5)
 
+/* Length of the calibration fingerprint, COEFF2 up to VARIANT_ID */
+#define BME68X_LEN_CALIB_FPRINT                   UINT8_C(16)
+
+/* Layout tag of a calibration cache, differs between the float and the integer build */
+#ifdef BME68X_USE_FPU
+#define BME68X_CALIB_CACHE_MAGIC                  UINT16_C(0x68f1)
+#else
+#define BME68X_CALIB_CACHE_MAGIC                  UINT16_C(0x6811)
+#endif
+
 /* Length of the field */
 #define BME68X_LEN_FIELD                          UINT8_C(17)
 
@@ -336,8 +382,23 @@
 /* Length of the configuration register */
 #define BME68X_LEN_CONFIG                         UINT8_C(5)
 
-/* Length of the interleaved buffer */
-#define BME68X_LEN_INTERLEAVE_BUFF                UINT8_C(20)
+/* Length of the interleaved buffer, large enough for a compiled configuration image */
+#define BME68X_LEN_INTERLEAVE_BUFF                UINT8_C(2 * BME68X_LEN_CONF_IMAGE)
+
+/* Length of the register shadow, IDAC_HEAT_0 up to CONFIG */
+#define BME68X_LEN_SHADOW                         UINT8_C(38)
+
+/* Length of a compiled heater image: 10 res_heat, 10 gas_wait, shared duration, CTRL_GAS_0 and CTRL_GAS_1 */
+#define BME68X_LEN_HEATR_IMAGE                    UINT8_C(23)
+
+/* Length of a compiled configuration image: the heater image plus CTRL_HUM, CTRL_MEAS and CONFIG */
+#define BME68X_LEN_CONF_IMAGE                     UINT8_C(BME68X_LEN_HEATR_IMAGE + 3)
+
+/* Number of control registers of a configuration image: CTRL_GAS_0, CTRL_GAS_1, CTRL_HUM, CTRL_MEAS and CONFIG */
+#define BME68X_LEN_CONF_CTRL                      UINT8_C(5)
+
+/* Number of samples compensated per pass by bme68x_compensate_batch() */
+#define BME68X_BATCH_CHUNK                        UINT8_C(64)
 
 /* Coefficient index macros */
 
@@ -517,6 +578,7 @@
 #define BME68X_HEATR_DUR1_DELAY                   UINT32_C(1000000)
 #define BME68X_HEATR_DUR2_DELAY                   UINT32_C(2000000)
 #define BME68X_N_MEAS                             UINT8_C(6)
+#define BME68X_HEATR_DUR_QUICK                    UINT16_C(100)
 #define BME68X_LOW_TEMP                           UINT8_C(150)
 #define BME68X_HIGH_TEMP                          UINT16_C(350)
 
@@ -712,6 +774,88 @@ enum bme68x_intf {
 
 /* Structure definitions */
 
+/*
+ * @brief Undecoded sensor field, as read from the field registers
+ */
+struct bme68x_raw_data
+{
+    /*! Contains new_data, gasm_valid & heat_stab */
+    uint8_t status;
+
+    /*! The index of the heater profile used */
+    uint8_t gas_index;
+
+    /*! Measurement index to track order */
+    uint8_t meas_index;
+
+    /*! Heater resistance */
+    uint8_t res_heat;
+
+    /*! Current DAC */
+    uint8_t idac;
+
+    /*! Gas wait period */
+    uint8_t gas_wait;
+
+    /*! Field registers, meas_status through gas_r_lsb */
+    uint8_t field[BME68X_LEN_FIELD];
+};
+
+/*
+ * @brief Raw ADC values of many samples, one array per quantity
+ */
+struct bme68x_raw_batch
+{
+    /*! Temperature ADC values, 20 bit */
+    const uint32_t *temp_adc;
+
+    /*! Pressure ADC values, 20 bit. NULL to skip pressure */
+    const uint32_t *pres_adc;
+
+    /*! Humidity ADC values, 16 bit. NULL to skip humidity */
+    const uint16_t *hum_adc;
+
+    /*! Gas ADC values, 10 bit. NULL to skip gas */
+    const uint16_t *gas_adc;
+
+    /*! Gas range of each gas ADC value */
+    const uint8_t *gas_range;
+};
+
+/*
+ * @brief Compensated values of many samples, one array per quantity
+ */
+struct bme68x_data_batch
+{
+#ifndef BME68X_USE_FPU
+
+    /*! Temperature in degree celsius x100 */
+    int16_t *temperature;
+
+    /*! Pressure in Pascal */
+    uint32_t *pressure;
+
+    /*! Humidity in % relative humidity x1000 */
+    uint32_t *humidity;
+
+    /*! Gas resistance in Ohms */
+    uint32_t *gas_resistance;
+#else
+
+    /*! Temperature in degree celsius */
+    float *temperature;
+
+    /*! Pressure in Pascal */
+    float *pressure;
+
+    /*! Humidity in % relative humidity */
+    float *humidity;
+
+    /*! Gas resistance in Ohms */
+    float *gas_resistance;
+#endif
+};
+
 /*
  * @brief Sensor field data structure
  */
@@ -765,6 +909,43 @@ struct bme68x_data
 
 };
 
+#ifndef BME68X_USE_FPU
+
+/*
+ * @brief Calibration-only terms of the integer compensation, derived once
+ * from the coefficients when they are read
+ */
+struct bme68x_comp_data
+{
+    /*! par_t1 << 1 */
+    int32_t t1_x2;
+
+    /*! par_t3 << 4 */
+    int32_t t3_x16;
+
+    /*! par_p3 << 5 */
+    int32_t p3_x32;
+
+    /*! par_p4 << 16 */
+    int32_t p4_x65536;
+
+    /*! par_p7 << 7 */
+    int32_t p7_x128;
+
+    /*! par_h1 * 16 */
+    int32_t h1_x16;
+
+    /*! par_h6 << 7 */
+    int32_t h6_x128;
+
+    /*! Low gas variant: range_sw_err offset of the gas ADC, per gas range */
+    int32_t gas_var1[16];
+
+    /*! Low gas variant: dividend of the gas resistance, per gas range */
+    uint64_t gas_var3[16];
+};
+#endif
+
 /*
  * @brief Structure to hold the calibration coefficients
  */
@@ -856,6 +1037,11 @@ struct bme68x_calib_data
 
     /*! Gas resistance range switching error coefficient */
     int8_t range_sw_err;
+#ifndef BME68X_USE_FPU
+
+    /*! Precomputed compensation terms */
+    struct bme68x_comp_data comp;
+#endif
 };
 
 /*
@@ -913,6 +1099,151 @@ struct bme68x_heatr_conf
     uint16_t shared_heatr_dur;
 };
 
+/*
+ * @brief Heater configuration compiled to register values, refer bme68x_compile_heatr_conf()
+ */
+struct bme68x_heatr_image
+{
+    /*! Operation mode the image was compiled for */
+    uint8_t op_mode;
+
+    /*! Ambient temperature in degree C the heater resistances were computed for */
+    int8_t amb_temp;
+
+    /*! Heater control bit of CTRL_GAS_0 */
+    uint8_t hctrl;
+
+    /*! Gas measurement bits of CTRL_GAS_1 */
+    uint8_t run_gas;
+
+    /*! Number of heater profile steps of CTRL_GAS_1 */
+    uint8_t nb_conv;
+
+    /*! Number of registers in the image */
+    uint8_t len;
+
+    /*! Register addresses, CTRL_GAS_0 and CTRL_GAS_1 last */
+    uint8_t reg_addr[BME68X_LEN_HEATR_IMAGE];
+
+    /*! Register values, the CTRL_GAS_* bits outside the heater settings are merged in when applied */
+    uint8_t reg_data[BME68X_LEN_HEATR_IMAGE];
+};
+
+/*
+ * @brief Sensor and heater configuration compiled to register values, refer bme68x_compile_conf()
+ */
+struct bme68x_conf_image
+{
+    /*! Operation mode the image was compiled for */
+    uint8_t op_mode;
+
+    /*! Ambient temperature in degree C the heater resistances were computed for */
+    int8_t amb_temp;
+
+    /*! Number of registers in the image */
+    uint8_t len;
+
+    /*! Register addresses, the BME68X_LEN_CONF_CTRL control registers last */
+    uint8_t reg_addr[BME68X_LEN_CONF_IMAGE];
+
+    /*! Register values */
+    uint8_t reg_data[BME68X_LEN_CONF_IMAGE];
+
+    /*! Bits of each control register set by the image, the others are kept when applied */
+    uint8_t ctrl_mask[BME68X_LEN_CONF_CTRL];
+};
+
+/*!
+ * @brief Completion callback of an asynchronous measurement
+ *
+ * @param[in] rslt   : Result of the measurement, as returned by bme68x_get_data()
+ * @param[in] data   : Compensated fields, sorted as by bme68x_get_data(). NULL in raw mode
+ * @param[in] n_data : Number of new fields, 0 in raw mode
+ * @param[in] cb_arg : User pointer given in bme68x_async
+ */
+typedef void (*bme68x_async_cb_t)(int8_t rslt, const struct bme68x_data *data, uint8_t n_data, void *cb_arg);
+
+/*
+ * @brief State of an asynchronous measurement, driven by bme68x_async_step()
+ */
+struct bme68x_async
+{
+    /*! Current state. Refer BME68X_ASYNC_* */
+    uint8_t state;
+
+    /*! Operation mode requested in bme68x_async_start() */
+    uint8_t op_mode;
+
+    /*! Polls for new data left before giving up */
+    uint8_t tries;
+
+    /*! Last known value of the CTRL_MEAS register */
+    uint8_t ctrl_meas;
+
+    /*! Measurement duration in microseconds, TPH plus heating */
+    uint32_t meas_dur;
+
+    /*!
+     * Time in microseconds between two polls for new data, BME68X_PERIOD_POLL
+     * when 0. A shorter period gets more polls, over the same total time
+     */
+    uint32_t poll_us;
+
+    /*! Time in microseconds after which bme68x_async_step() is due */
+    uint32_t wait_us;
+
+    /*!
+     * Called when a result is ready or the measurement failed. May be NULL.
+     * With raw set it gets NULL and 0, the fields are in raw_data and n_data
+     */
+    bme68x_async_cb_t callback;
+
+    /*! User pointer passed to the callback */
+    void *cb_arg;
+
+    /*!
+     * When set, steps read the fields without compensating them. They go to
+     * raw_data, for bme68x_compensate_raw(), and data is not touched
+     */
+    uint8_t raw;
+
+    /*! Last result */
+    struct bme68x_data data[3];
+
+    /*! Last result read with raw set, data keeps whatever it held before */
+    struct bme68x_raw_data raw_data[3];
+
+    /*! Number of new fields in the last result */
+    uint8_t n_data;
+};
+
+/*
+ * @brief Calibration data saved across boots, refer bme68x_get_calib_cache()
+ */
+struct bme68x_calib_cache
+{
+    /*! CRC-16/CCITT of everything after this member */
+    uint16_t crc;
+
+    /*! Size of the structure */
+    uint16_t len;
+
+    /*! BME68X_CALIB_CACHE_MAGIC of the build that wrote the cache */
+    uint16_t magic;
+
+    /*! Chip Id */
+    uint8_t chip_id;
+
+    /*! Variant id */
+    uint32_t variant_id;
+
+    /*! Registers COEFF2 up to VARIANT_ID, compared against the sensor on a cached init */
+    uint8_t fprint[BME68X_LEN_CALIB_FPRINT];
+
+    /*! Parsed calibration data */
+    struct bme68x_calib_data calib;
+};
+
 /*
  * @brief BME68X device structure
  */
@@ -943,7 +1274,7 @@ struct bme68x_dev
     /*! SPI/I2C interface */
     enum bme68x_intf intf;
 
-    /*! Memory page used */
+    /*! Memory page selected on the sensor, SPI only. Kept up to date by the driver */
     uint8_t mem_page;
 
     /*! Ambient temperature in Degree C*/
@@ -966,6 +1297,15 @@ struct bme68x_dev
 
     /*! Store the info messages */
     uint8_t info_msg;
+
+    /*! Register shadow selection. Refer BME68X_SHADOW_* */
+    uint8_t shadow_en;
+
+    /*! Set once the register shadow mirrors the sensor */
+    uint8_t shadow_valid;
+
+    /*! Shadow of the registers from IDAC_HEAT_0 (0x50) up to CONFIG (0x75) */
+    uint8_t shadow[BME68X_LEN_SHADOW];
 };
 
 #endif /* BME68X_DEFS_H_ */
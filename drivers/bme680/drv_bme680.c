@@ -1,23 +1,142 @@
 #include <drv_bme680.h>
 #include <stdint.h>
-#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "driver/i2c_master.h"
 #include "driver/i2c_types.h"
+#include "driver/spi_master.h"
+#include "soc/soc_caps.h"
 
+#include "esp_attr.h"
 #include "esp_err.h"
 #include "esp_rom_sys.h"
 #include "esp_log.h"
+#include "nvs.h"
 
 #include "macros.h"
 #include "bme68x.h"
 #include "drv_bme680.h"
 
-#include "../../../../../../../ESP/v5.5.1/esp-idf/components/esp_driver_i2c/i2c_private.h"
-
 char *TAG = "I2C DRIVER";
 
+/* Calibration cache: RTC slow memory survives deep sleep, NVS survives power cycles */
+static RTC_DATA_ATTR struct bme68x_calib_cache rtc_calib_cache[BME680_MAX_SENSORS];
+
+/* Self-test results, NVS is only written when they change */
+static RTC_DATA_ATTR bme680_selftest_record_t rtc_selftest[BME680_MAX_SENSORS];
+
+/* Sensors of the table, indexed like it, and the ids of the ones that answered */
+static struct bme68x_dev sensors[BME680_MAX_SENSORS];
+static struct bme68x_bus_ctx sensor_ctx[BME680_MAX_SENSORS];
+static uint8_t registry[BME680_MAX_SENSORS];
+static uint8_t n_registered;
+
+
+#define XFER_SLOTS  (BME680_I2C_QUEUE_DEPTH + 1)
+
+static uint8_t xfer_next(uint8_t slot)
+{
+    return (uint8_t)((slot + 1 == XFER_SLOTS) ? 0 : slot + 1);
+}
+
+/* Slot for the next transaction of ctx, NULL when the sensor's share of the bus queue is full */
+static struct bme68x_xfer *xfer_push(struct bme68x_bus_ctx *ctx, uint8_t reg_addr,
+                                     struct bme68x_dev *handle, bme680_xfer_cb_t cb, void *arg)
+{
+    uint8_t head = ctx->xfer_head;
+
+    if (xfer_next(head) == ctx->xfer_tail) {
+        return NULL;
+    }
+
+    /* Filled before it is published, the ISR may complete it as soon as it is queued */
+    struct bme68x_xfer *x = &ctx->xfer[head];
+    x->reg_addr = reg_addr;
+    x->handle = handle;
+    x->cb = cb;
+    x->arg = arg;
+    ctx->xfer_head = xfer_next(head);
+    return x;
+}
+
+/* Take back the last slot when the driver refused to queue its transaction */
+static void xfer_drop(struct bme68x_bus_ctx *ctx)
+{
+    uint8_t head = ctx->xfer_head;
+
+    ctx->xfer_head = (uint8_t)((head == 0) ? XFER_SLOTS - 1 : head - 1);
+}
+
+/* on_trans_done of the sensor's I2C device, its transactions complete in queue order */
+static bool IRAM_ATTR i2c_xfer_done(i2c_master_dev_handle_t i2c_dev, const i2c_master_event_data_t *evt_data, void *arg)
+{
+    struct bme68x_bus_ctx *ctx = arg;
+    struct bme68x_xfer x = ctx->xfer[ctx->xfer_tail];
+    esp_err_t err = (evt_data->event == I2C_EVENT_DONE) ? ESP_OK : ESP_FAIL;
+
+    (void)i2c_dev;
+    if (err != ESP_OK && ctx->xfer_err == ESP_OK) {
+        ctx->xfer_err = err;
+    }
+
+    /* Free the slot first, the callback may queue the next transaction */
+    ctx->xfer_tail = xfer_next(ctx->xfer_tail);
+    return x.cb ? x.cb(x.handle, err, x.arg) : false;
+}
+
+/* Queue a read, the address byte lives in the slot until the transaction is done */
+static esp_err_t i2c_queue_read(struct bme68x_bus_ctx *ctx, uint8_t reg_addr, uint8_t *reg_data, uint32_t length,
+                                struct bme68x_dev *handle, bme680_xfer_cb_t cb, void *arg)
+{
+    struct bme68x_xfer *x = xfer_push(ctx, reg_addr, handle, cb, arg);
+
+    if (!x) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = i2c_master_transmit_receive(ctx->dev, &x->reg_addr, 1, reg_data, length, -1);
+    if (err != ESP_OK) {
+        xfer_drop(ctx);
+    }
+    return err;
+}
+
+/* Queue a write, the payload is sent from reg_data */
+static esp_err_t i2c_queue_write(struct bme68x_bus_ctx *ctx, uint8_t reg_addr, const uint8_t *reg_data,
+                                 uint32_t length, struct bme68x_dev *handle, bme680_xfer_cb_t cb, void *arg)
+{
+    struct bme68x_xfer *x = xfer_push(ctx, reg_addr, handle, cb, arg);
+
+    if (!x) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    i2c_master_transmit_multi_buffer_info_t bufs[2] = {
+        { .write_buffer = &x->reg_addr, .buffer_size = 1 },
+        { .write_buffer = (uint8_t *)reg_data, .buffer_size = length },
+    };
+
+    esp_err_t err = i2c_master_multi_buffer_transmit(ctx->dev, bufs, 2, -1);
+    if (err != ESP_OK) {
+        xfer_drop(ctx);
+    }
+    return err;
+}
+
+/* Wait for the bus queue to drain and collect the failures of ctx. The IDF only waits for the whole bus,
+ * so this also waits for the transactions the other sensors of the port queued */
+static esp_err_t i2c_queue_wait(struct bme68x_bus_ctx *ctx, int timeout_ms)
+{
+    esp_err_t err = i2c_master_bus_wait_all_done(ctx->bus, timeout_ms);
+
+    if (err == ESP_OK) {
+        err = ctx->xfer_err;
+    }
+    ctx->xfer_err = ESP_OK;
+    return err;
+}
 
 /* Mapping READ function for BME68X driver */
 static BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr,
@@ -25,13 +144,22 @@ static BME68X_INTF_RET_TYPE bme68x_i2c_read(uint8_t reg_addr,
                                             uint32_t length,
                                             void *intf_ptr)
 {
-    struct bme68x_i2c_ctx *ctx = intf_ptr;
+    struct bme68x_bus_ctx *ctx = intf_ptr;
+    esp_err_t err;
 
     if (!ctx || !ctx->dev || !reg_data || length == 0) {
         return (BME68X_INTF_RET_TYPE)-1;
     }
 
-    esp_err_t err = i2c_master_transmit_receive(ctx->dev, &reg_addr, 1, reg_data, length, -1);
+    /* The driver expects the bytes on return: on a queued bus, wait for them, and for the bus queue ahead */
+    if (ctx->async) {
+        err = i2c_queue_read(ctx, reg_addr, reg_data, length, NULL, NULL, NULL);
+        if (err == ESP_OK) {
+            err = i2c_queue_wait(ctx, -1);
+        }
+    } else {
+        err = i2c_master_transmit_receive(ctx->dev, &reg_addr, 1, reg_data, length, -1);
+    }
     return (err == ESP_OK) ? BME68X_INTF_RET_SUCCESS : (BME68X_INTF_RET_TYPE)-1;
 }
 
@@ -41,124 +169,604 @@ static BME68X_INTF_RET_TYPE bme68x_i2c_write(uint8_t reg_addr,
                                              uint32_t length,
                                              void *intf_ptr)
 {
-    struct bme68x_i2c_ctx *ctx = intf_ptr;
+    struct bme68x_bus_ctx *ctx = intf_ptr;
+    esp_err_t err;
 
     if (!ctx || !ctx->dev || !reg_data || length == 0) {
         return (BME68X_INTF_RET_TYPE)-1;
     }
 
-    uint8_t *buf = malloc(length + 1);
-    if (!buf) {
+    if (ctx->async) {
+        err = i2c_queue_write(ctx, reg_addr, reg_data, length, NULL, NULL, NULL);
+        if (err == ESP_OK) {
+            err = i2c_queue_wait(ctx, -1);
+        }
+        return (err == ESP_OK) ? BME68X_INTF_RET_SUCCESS : (BME68X_INTF_RET_TYPE)-1;
+    }
+
+    /* Address byte and payload go out back to back in one transaction, without a copy or the heap.
+     * The driver keeps the buffers untouched, the cast only satisfies the IDF prototype */
+    i2c_master_transmit_multi_buffer_info_t bufs[2] = {
+        { .write_buffer = &reg_addr, .buffer_size = 1 },
+        { .write_buffer = (uint8_t *)reg_data, .buffer_size = length },
+    };
+
+    err = i2c_master_multi_buffer_transmit(ctx->dev, bufs, 2, -1);
+
+    return (err == ESP_OK) ? BME68X_INTF_RET_SUCCESS : (BME68X_INTF_RET_TYPE)-1;
+}
+
+esp_err_t bme680_i2c_read_async(struct bme68x_dev *handle, uint8_t reg_addr, uint8_t *reg_data, uint32_t length,
+                                bme680_xfer_cb_t cb, void *arg) {
+
+    struct bme68x_bus_ctx *ctx = handle ? handle->intf_ptr : NULL;
+
+    if (!ctx || !ctx->dev || !reg_data || length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ctx->async) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return i2c_queue_read(ctx, reg_addr, reg_data, length, handle, cb, arg);
+}
+
+esp_err_t bme680_i2c_write_async(struct bme68x_dev *handle, uint8_t reg_addr, const uint8_t *reg_data,
+                                 uint32_t length, bme680_xfer_cb_t cb, void *arg) {
+
+    struct bme68x_bus_ctx *ctx = handle ? handle->intf_ptr : NULL;
+
+    if (!ctx || !ctx->dev || !reg_data || length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!ctx->async) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return i2c_queue_write(ctx, reg_addr, reg_data, length, handle, cb, arg);
+}
+
+esp_err_t bme680_i2c_wait(struct bme68x_dev *handle, int timeout_ms) {
+
+    struct bme68x_bus_ctx *ctx = handle ? handle->intf_ptr : NULL;
+
+    if (!ctx || !ctx->dev) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ctx->async ? i2c_queue_wait(ctx, timeout_ms) : ESP_OK;
+}
+
+/* Mapping READ function for BME68X driver over SPI, the driver already set the read bit and the page */
+static BME68X_INTF_RET_TYPE bme68x_spi_read(uint8_t reg_addr,
+                                            uint8_t *reg_data,
+                                            uint32_t length,
+                                            void *intf_ptr)
+{
+    struct bme68x_bus_ctx *ctx = intf_ptr;
+
+    if (!ctx || !ctx->spi || !reg_data || length == 0) {
         return (BME68X_INTF_RET_TYPE)-1;
     }
 
-    buf[0] = reg_addr;
-    memcpy(&buf[1], reg_data, length);
+    /* Without DMA a transaction holds SOC_SPI_MAXIMUM_BUFFER_SIZE bytes, the address increments within the page */
+    while (length > 0) {
+        uint32_t chunk = MIN(length, (uint32_t)SOC_SPI_MAXIMUM_BUFFER_SIZE);
+        spi_transaction_t t = {
+            .cmd = reg_addr,
+            .rxlength = chunk * 8,
+            .rx_buffer = reg_data,
+        };
+
+        if (spi_device_polling_transmit(ctx->spi, &t) != ESP_OK) {
+            return (BME68X_INTF_RET_TYPE)-1;
+        }
+        reg_addr = (uint8_t)(reg_addr + chunk);
+        reg_data += chunk;
+        length -= chunk;
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
 
-    esp_err_t err = i2c_master_transmit(ctx->dev, buf, length + 1, -1);
-    free(buf);
+/* Mapping WRITE function for BME68X driver over SPI, reg_data holds the data then address/data pairs */
+static BME68X_INTF_RET_TYPE bme68x_spi_write(uint8_t reg_addr,
+                                             const uint8_t *reg_data,
+                                             uint32_t length,
+                                             void *intf_ptr)
+{
+    struct bme68x_bus_ctx *ctx = intf_ptr;
+
+    if (!ctx || !ctx->spi || !reg_data || length == 0 || length > SOC_SPI_MAXIMUM_BUFFER_SIZE) {
+        return (BME68X_INTF_RET_TYPE)-1;
+    }
 
+    spi_transaction_t t = {
+        .cmd = reg_addr,
+        .length = length * 8,
+        .tx_buffer = reg_data,
+    };
+    esp_err_t err = spi_device_polling_transmit(ctx->spi, &t);
     return (err == ESP_OK) ? BME68X_INTF_RET_SUCCESS : (BME68X_INTF_RET_TYPE)-1;
 }
 
+/* Runs in the esp_timer task when a long wait is over */
+static void delay_timer_cb(void *arg)
+{
+    struct bme68x_bus_ctx *ctx = arg;
+
+    ctx->delay_done = true;
+    xTaskNotifyGive(ctx->delay_task);
+}
+
+/* Spin for short waits, sleep on the sensor's one-shot timer for the soft reset, polls and self-test steps */
 static void bme68x_delay_us(uint32_t period, void *intf_ptr)
 {
-    (void)intf_ptr;
+    struct bme68x_bus_ctx *ctx = intf_ptr;
+
     if (period == 0) {
         return;
     }
-    BLOCKING_DELAY_US(period);
+
+    /* Nothing to yield to before the scheduler runs */
+    if (period <= BME680_DELAY_SPIN_MAX_US || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        BLOCKING_DELAY_US(period);
+        return;
+    }
+
+    if (ctx && ctx->delay_timer) {
+        ctx->delay_task = xTaskGetCurrentTaskHandle();
+        ctx->delay_done = false;
+    }
+    if (!ctx || !ctx->delay_timer || esp_timer_start_once(ctx->delay_timer, period) != ESP_OK) {
+        /* Tick resolution, rounded up so the wait is never short */
+        vTaskDelay(pdMS_TO_TICKS(DIV_ROUND_UP(period, 1000U)) + 1);
+        return;
+    }
+
+    /* A notification meant for something else only costs a loop */
+    while (!ctx->delay_done) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
 }
 
 
-static esp_err_t bme68x_i2c_init_dev(struct bme68x_dev *dev,
-                         struct bme68x_i2c_ctx *ctx)
+static esp_err_t bme68x_bus_init_dev(struct bme68x_dev *dev,
+                         struct bme68x_bus_ctx *ctx,
+                         enum bme68x_intf intf)
 {
     if (!dev || !ctx) {
         return ESP_ERR_INVALID_ARG;
     }
 
     memset(dev, 0, sizeof(*dev));
-    dev->intf = BME68X_I2C_INTF;
+    dev->intf = intf;
     dev->intf_ptr = ctx;
-    dev->read = bme68x_i2c_read;
-    dev->write = bme68x_i2c_write;
+    dev->read = (intf == BME68X_SPI_INTF) ? bme68x_spi_read : bme68x_i2c_read;
+    dev->write = (intf == BME68X_SPI_INTF) ? bme68x_spi_write : bme68x_i2c_write;
     dev->delay_us = bme68x_delay_us;
     dev->amb_temp = 25;
     dev->intf_rslt = BME68X_INTF_RET_SUCCESS;
     dev->info_msg = 0;
     dev->variant_id = BME68X_VARIANT_GAS_LOW;
+    dev->shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL;
+
+    /* Kept for the life of the context, the waits never allocate */
+    if (!ctx->delay_timer) {
+        esp_timer_create_args_t timerCfg = {
+            .callback = delay_timer_cb,
+            .arg = ctx,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "bme68x_delay",
+        };
+
+        if (esp_timer_create(&timerCfg, &ctx->delay_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "No delay timer, long waits fall back to vTaskDelay");
+            ctx->delay_timer = NULL;
+        }
+    }
 
     return ESP_OK;
 }
 
 
 
-esp_err_t bm68x_i2c_init_itf(struct bme68x_dev *handle, struct bme68x_i2c_ctx *ctx) {
+esp_err_t bm68x_i2c_init_itf(struct bme68x_dev *handle, struct bme68x_bus_ctx *ctx, const bme680_sensor_cfg_t *cfg) {
 
     /* Check parameters */
-    if (ctx->bus != NULL) {
-        ESP_LOGW(TAG, "I2C Bus already initialized");
+    if (!handle || !ctx || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ctx->dev != NULL) {
+        ESP_LOGW(TAG, "BME680 0x%02x already initialized", cfg->addr);
         return ESP_OK;
     }
 
-    bme68x_i2c_init_dev(handle, ctx);
+    bme68x_bus_init_dev(handle, ctx, BME68X_I2C_INTF);
+    ctx->async = false;
+    ctx->xfer_head = 0;
+    ctx->xfer_tail = 0;
+    ctx->xfer_err = ESP_OK;
 
+    /* The sensors of a port share its bus, the first one creates it */
+    bool new_bus = false;
+    esp_err_t err = i2c_master_get_bus_handle(cfg->port, &ctx->bus);
+    if (err != ESP_OK) {
 
-    /* Master Bus config */
-    i2c_master_bus_config_t busCfg = {
-        .i2c_port = I2C_PORT_NUM,
-        .sda_io_num = I2C_SDA_GPIO,
-        .scl_io_num = I2C_SCL_GPIO,
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .glitch_ignore_cnt = 7,
-        .intr_priority = 0,
-        .trans_queue_depth = 0,
-        .flags = {
-            .enable_internal_pullup = 0,
-        },
-    };
+        /* Master Bus config */
+        i2c_master_bus_config_t busCfg = {
+            .i2c_port = cfg->port,
+            .sda_io_num = cfg->sda_gpio,
+            .scl_io_num = cfg->scl_gpio,
+            .clk_source = I2C_CLK_SRC_DEFAULT,
+            .glitch_ignore_cnt = 7,
+            .intr_priority = 0,
+            .trans_queue_depth = BME680_I2C_QUEUE_DEPTH,
+            .flags = {
+                .enable_internal_pullup = 0,
+            },
+        };
+
+        /* Initialize I2C Master Bus */
+        err = i2c_new_master_bus(&busCfg, &ctx->bus);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "i2c_new_master_bus failed: %s", esp_err_to_name(err));
+            ctx->bus = NULL;
+            return ESP_FAIL;
+        }
+        new_bus = true;
+        ESP_LOGI(TAG, "I2C master bus %d initialized", cfg->port);
+    }
 
     /* Device config */
     i2c_device_config_t devCfg = {
         .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = BME680_I2C_ADDR_1,
+        .device_address = cfg->addr,
         .scl_speed_hz = I2C_CLK_HZ,
     };
 
-    /* Initialize I2C Master Bus */
-    esp_err_t err = i2c_new_master_bus(&busCfg, &ctx->bus);
+    /* Probe the I2C device to detect its presence on the bus */
+    err = i2c_master_probe(ctx->bus, devCfg.device_address, 1000);
+    if (err == ESP_OK) {
+
+        /* Register BME680 device on the bus */
+        err = i2c_master_bus_add_device(ctx->bus, &devCfg, &ctx->dev);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "i2c_master_bus_add_device failed: %s", esp_err_to_name(err));
+            ctx->dev = NULL;
+        }
+#if BME680_I2C_QUEUE_DEPTH > 0
+        /* A bus created elsewhere without a queue refuses the callback, the sensor then stays blocking */
+        if (err == ESP_OK) {
+            i2c_master_event_callbacks_t cbs = { .on_trans_done = i2c_xfer_done };
+            ctx->async = (i2c_master_register_event_callbacks(ctx->dev, &cbs, ctx) == ESP_OK);
+        }
+#endif
+    } else {
+        ESP_LOGW(TAG, "No device at port %d address 0x%02x: %s", cfg->port, cfg->addr, esp_err_to_name(err));
+        err = ESP_ERR_NOT_FOUND;
+    }
+
+    /* Read Chip ID to confirm it's the right sensor */
+    if (err == ESP_OK) {
+        uint8_t chip_id = 0;
+        BME68X_INTF_RET_TYPE status = bme68x_i2c_read(BME680_REG_CHIP_ID, &chip_id, 1, ctx);
+        if (status != BME68X_INTF_RET_SUCCESS || chip_id != BME680_EXPECTED_CHIP_ID) {
+            ESP_LOGE(TAG, "CHIP_ID at port %d address 0x%02x: 0x%02x", cfg->port, cfg->addr, chip_id);
+            i2c_master_bus_rm_device(ctx->dev);
+            ctx->dev = NULL;
+            err = ESP_ERR_NOT_FOUND;
+        }
+    }
+
+    /* Release the pins of a port nothing answers on */
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "i2c_new_master_bus failed: %s", esp_err_to_name(err));
+        if (new_bus) {
+            i2c_del_master_bus(ctx->bus);
+        }
+        ctx->bus = NULL;
+        return err;
+    }
+
+    ctx->bus_owner = new_bus;
+    return ESP_OK;
+}
+
+esp_err_t bm68x_spi_init_itf(struct bme68x_dev *handle, struct bme68x_bus_ctx *ctx, const bme680_sensor_cfg_t *cfg) {
+
+    /* Check parameters */
+    if (!handle || !ctx || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ctx->spi != NULL) {
+        ESP_LOGW(TAG, "BME680 on CS %d already initialized", cfg->cs_gpio);
+        return ESP_OK;
+    }
+
+    bme68x_bus_init_dev(handle, ctx, BME68X_SPI_INTF);
+
+    /* SPI Bus config, no DMA: the longest transfer is a 51 byte burst */
+    spi_bus_config_t busCfg = {
+        .mosi_io_num = cfg->mosi_gpio,
+        .miso_io_num = cfg->miso_gpio,
+        .sclk_io_num = cfg->sclk_gpio,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = SOC_SPI_MAXIMUM_BUFFER_SIZE,
+    };
+
+    /* The sensors of a host share its bus, the first one initializes it */
+    esp_err_t err = spi_bus_initialize(cfg->spi_host, &busCfg, SPI_DMA_DISABLED);
+    ctx->bus_owner = (err == ESP_OK);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "SPI bus %d initialized", cfg->spi_host);
+    } else if (err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "spi_bus_initialize failed: %s", esp_err_to_name(err));
         return ESP_FAIL;
     }
 
-    /* Register BME680 device on the bus */
-    err = i2c_master_bus_add_device(ctx->bus, &devCfg, &ctx->dev);
+    /* Device config: the register address goes in the command phase, SPI mode 0 */
+    spi_device_interface_config_t devCfg = {
+        .command_bits = 8,
+        .address_bits = 0,
+        .mode = 0,
+        .clock_speed_hz = SPI_CLK_HZ,
+        .spics_io_num = cfg->cs_gpio,
+        .flags = SPI_DEVICE_HALFDUPLEX,
+        .queue_size = 1,
+    };
+
+    /* Register BME680 device on the bus, the chip id is checked by bme68x_init() */
+    err = spi_bus_add_device(cfg->spi_host, &devCfg, &ctx->spi);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "i2c_master_bus_add_device failed: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "spi_bus_add_device failed: %s", esp_err_to_name(err));
+        ctx->spi = NULL;
+        if (ctx->bus_owner) {
+            spi_bus_free(cfg->spi_host);
+            ctx->bus_owner = false;
+        }
         return ESP_FAIL;
     }
 
-    /* Probe the I2C device to detect its presence on the bus */
-    err = i2c_master_probe(ctx->bus, devCfg.device_address, 1000);
+    return ESP_OK;
+}
+
+uint8_t bme680_registry_init(const bme680_sensor_cfg_t *cfg, uint8_t n_cfg) {
+
+    if (n_cfg > BME680_MAX_SENSORS) {
+        ESP_LOGW(TAG, "Sensor table has %u entries, only the first %u are used", n_cfg, BME680_MAX_SENSORS);
+        n_cfg = BME680_MAX_SENSORS;
+    }
+
+    for (uint8_t id = 0; id < n_cfg; id++) {
+        struct bme68x_bus_ctx *ctx = &sensor_ctx[id];
+
+        /* The table position stays the id when sensors before it are missing */
+        ctx->id = id;
+        bool spi = (cfg[id].intf == BME68X_SPI_INTF);
+        esp_err_t err = spi ? bm68x_spi_init_itf(&sensors[id], ctx, &cfg[id]) :
+            bm68x_i2c_init_itf(&sensors[id], ctx, &cfg[id]);
+        if (err != ESP_OK) {
+            continue;
+        }
+
+        int8_t rslt = bme68x_init_fast(&sensors[id]);
+        if (rslt != BME68X_OK) {
+            ESP_LOGE(TAG, "BME68X %u initialization failed: %d", id, rslt);
+            if (spi) {
+                spi_bus_remove_device(ctx->spi);
+                ctx->spi = NULL;
+            } else {
+                i2c_master_bus_rm_device(ctx->dev);
+                ctx->dev = NULL;
+            }
+
+            /* A bus created for this sensor has no other one yet: release its pins, a later sensor of the
+             * same port creates it again */
+            if (ctx->bus_owner) {
+                if (spi) {
+                    spi_bus_free(cfg[id].spi_host);
+                } else {
+                    i2c_del_master_bus(ctx->bus);
+                }
+                ctx->bus_owner = false;
+            }
+            ctx->bus = NULL;
+            continue;
+        }
+
+        if (spi) {
+            ESP_LOGI(TAG, "BME68X %u at SPI host %d CS %d", id, cfg[id].spi_host, cfg[id].cs_gpio);
+        } else {
+            ESP_LOGI(TAG, "BME68X %u at port %d address 0x%02x", id, cfg[id].port, cfg[id].addr);
+        }
+        registry[n_registered++] = id;
+    }
+
+    return n_registered;
+}
+
+uint8_t bme680_registry_count(void) {
+    return n_registered;
+}
+
+struct bme68x_dev *bme680_registry_get(uint8_t index) {
+    return (index < n_registered) ? &sensors[registry[index]] : NULL;
+}
+
+uint8_t bme680_sensor_id(const struct bme68x_dev *handle) {
+    const struct bme68x_bus_ctx *ctx = handle->intf_ptr;
+
+    return (ctx && ctx->id < BME680_MAX_SENSORS) ? ctx->id : 0;
+}
+
+/* NVS key of a sensor: the bare key for the first one, so single sensor boards keep theirs */
+static void nvs_key(char *key, size_t len, const char *base, uint8_t id)
+{
+    if (id == 0) {
+        snprintf(key, len, "%s", base);
+    } else {
+        snprintf(key, len, "%s%u", base, id);
+    }
+}
+
+/* Load a blob saved under the driver NVS namespace, it must be exactly len bytes */
+static esp_err_t nvs_load(const char *key, void *blob, size_t len)
+{
+    nvs_handle_t nvs;
+    size_t stored = len;
+
+    esp_err_t err = nvs_open(BME680_NVS_NAMESPACE, NVS_READONLY, &nvs);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "i2c_master_probe failed: %s", esp_err_to_name(err));
-        return ESP_FAIL;
+        return err;
     }
 
-    /* Read Chip ID to confirm it's the right sensor */
-    uint8_t chip_id = 0;
-    BME68X_INTF_RET_TYPE status = bme68x_i2c_read(ctx->dev->device_address, &chip_id, 1, ctx);
-    if (status != BME68X_INTF_RET_SUCCESS) {
-        ESP_LOGE(TAG, "CHIP_ID read failed: %s", esp_err_to_name(err));
-        return ESP_FAIL;
+    err = nvs_get_blob(nvs, key, blob, &stored);
+    nvs_close(nvs);
+    if (err == ESP_OK && stored != len) {
+        err = ESP_ERR_INVALID_SIZE;
     }
+    return err;
+}
 
+/* Save a blob under the driver NVS namespace */
+static esp_err_t nvs_store(const char *key, const void *blob, size_t len)
+{
+    nvs_handle_t nvs;
 
-    ESP_LOGI(TAG, "I2C master bus initialized");
-    return ESP_OK;
+    esp_err_t err = nvs_open(BME680_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
 
+    err = nvs_set_blob(nvs, key, blob, len);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+int8_t bme68x_init_fast(struct bme68x_dev *handle) {
+
+    struct bme68x_calib_cache nvs_cache;
+    struct bme68x_calib_cache *rtc_cache = &rtc_calib_cache[bme680_sensor_id(handle)];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+
+    /* Deep sleep wake: the cache is still in RTC memory */
+    int8_t rslt = bme68x_init_cached(rtc_cache, handle);
+    if (rslt == BME68X_OK) {
+        ESP_LOGI(TAG, "BME68X calibration from RTC memory");
+        return rslt;
+    }
+
+    /* Cold boot: the cache is in flash */
+    nvs_key(key, sizeof(key), BME680_NVS_KEY_CALIB, bme680_sensor_id(handle));
+    bool have_nvs = (nvs_load(key, &nvs_cache, sizeof(nvs_cache)) == ESP_OK);
+    if (have_nvs) {
+        rslt = bme68x_init_cached(&nvs_cache, handle);
+        if (rslt == BME68X_OK) {
+            *rtc_cache = nvs_cache;
+            ESP_LOGI(TAG, "BME68X calibration from NVS");
+            return rslt;
+        }
+    }
+
+    /* No cache or another sensor: full init, then save for the next boot */
+    rslt = bme68x_init(handle);
+    if (rslt != BME68X_OK) {
+        return rslt;
+    }
+
+    if (bme68x_get_calib_cache(rtc_cache, handle) == BME68X_OK) {
+        /* Spare the flash when the sensor did not change */
+        if (!have_nvs || memcmp(&nvs_cache, rtc_cache, sizeof(nvs_cache)) != 0) {
+            esp_err_t err = nvs_store(key, rtc_cache, sizeof(*rtc_cache));
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Saving BME68X calibration failed: %s", esp_err_to_name(err));
+            }
+        }
+    }
+
+    return BME68X_OK;
+}
+
+static void selftest_store(uint8_t id)
+{
+    char key[NVS_KEY_NAME_MAX_SIZE];
+
+    nvs_key(key, sizeof(key), BME680_NVS_KEY_SELFTEST, id);
+    esp_err_t err = nvs_store(key, &rtc_selftest[id], sizeof(rtc_selftest[id]));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Saving self-test result failed: %s", esp_err_to_name(err));
+    }
+}
+
+int8_t bme68x_selftest_boot(struct bme68x_dev *handle) {
+
+    uint8_t id = bme680_sensor_id(handle);
+    bme680_selftest_record_t *rec = &rtc_selftest[id];
+
+    /* Cold boot: RTC memory was lost, reload the record from flash */
+    bool cold = (rec->magic != BME680_SELFTEST_MAGIC);
+    if (cold) {
+        char key[NVS_KEY_NAME_MAX_SIZE];
+
+        nvs_key(key, sizeof(key), BME680_NVS_KEY_SELFTEST, id);
+        esp_err_t err = nvs_load(key, rec, sizeof(*rec));
+        if (err != ESP_OK || rec->magic != BME680_SELFTEST_MAGIC) {
+            memset(rec, 0, sizeof(*rec));
+            rec->magic = BME680_SELFTEST_MAGIC;
+            rec->quick_rslt = BME680_SELFTEST_NOT_RUN;
+            rec->full_rslt = BME680_SELFTEST_NOT_RUN;
+        }
+    }
+
+    if (rec->boots_since_full < UINT16_MAX) {
+        rec->boots_since_full++;
+    }
+
+    int8_t rslt = bme68x_selftest_quick(handle);
+    bool changed = (rslt != rec->quick_rslt);
+    rec->quick_rslt = rslt;
+    rec->quick_time_s = (int64_t)time(NULL);
+
+    /* Deep sleep wakes with an unchanged result stay out of flash */
+    if (cold || changed) {
+        selftest_store(id);
+    }
+    return rslt;
+}
+
+bool bme68x_selftest_full_due(const struct bme68x_dev *handle) {
+
+    const bme680_selftest_record_t *rec = &rtc_selftest[bme680_sensor_id(handle)];
+
+    /* At most once per boot, a failing sensor is retried on the next one */
+    return rec->magic == BME680_SELFTEST_MAGIC && rec->boots_since_full > 0 &&
+           (rec->full_rslt != BME68X_OK ||
+            rec->boots_since_full >= BME680_SELFTEST_FULL_EVERY_N_BOOTS);
+}
+
+int8_t bme68x_selftest_full(struct bme68x_dev *handle) {
+
+    uint8_t id = bme680_sensor_id(handle);
+    bme680_selftest_record_t *rec = &rtc_selftest[id];
+
+    /* The heater steps are seconds long, the delay hook sleeps through them */
+    int8_t rslt = bme68x_selftest_check(handle);
+    rec->magic = BME680_SELFTEST_MAGIC;
+    rec->full_rslt = rslt;
+    rec->full_time_s = (int64_t)time(NULL);
+    rec->boots_since_full = 0;
+    selftest_store(id);
+
+    /* The test reset the sensor */
+    handle->shadow_valid = 0;
+    if (handle->shadow_en) {
+        (void)bme68x_sync_shadow(handle);
+    }
+    return rslt;
+}
+
+const bme680_selftest_record_t *bme68x_selftest_record(const struct bme68x_dev *handle) {
+    return &rtc_selftest[bme680_sensor_id(handle)];
 }
 
 
@@ -185,6 +793,9 @@ void bme68x_check_rslt(const char api_name[], int8_t rslt)
     case BME68X_E_SELF_TEST:
         ESP_LOGI("[BME680]", "API name [%s]  Error [%d] : Self test error\r\n", api_name, rslt);
         break;
+    case BME68X_E_CALIB_CACHE:
+        ESP_LOGI("[BME680]", "API name [%s]  Error [%d] : Calibration cache invalid\r\n", api_name, rslt);
+        break;
     case BME68X_W_NO_NEW_DATA:
         ESP_LOGI("[BME680]", "API name [%s]  Warning [%d] : No new data found\r\n", api_name, rslt);
         break;
@@ -5,8 +5,15 @@
 #ifndef LAERA_FW_DRV_BME680_H
 #define LAERA_FW_DRV_BME680_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "driver/i2c_types.h"
+#include "driver/spi_master.h"
 
 #include "bme68x_defs.h"
 
@@ -16,6 +23,41 @@
 #define I2C_SCL_GPIO    22
 #define I2C_CLK_HZ      400000
 
+/* Transactions the I2C driver queues per bus, shared by every sensor of the port, and the most one sensor may
+ * have in flight. 0 makes every transaction blocking: nothing calls the async API yet, so none is queued by default */
+#ifndef BME680_I2C_QUEUE_DEPTH
+#define BME680_I2C_QUEUE_DEPTH  0
+#endif
+
+/* Second bus, for the sensors beyond the two addresses of the first */
+#define I2C1_PORT_NUM   I2C_NUM_1
+#define I2C1_SDA_GPIO   25
+#define I2C1_SCL_GPIO   26
+
+/* ----- SPI Config ----- */
+#define SPI_HOST_NUM    SPI3_HOST
+#define SPI_MOSI_GPIO   23
+#define SPI_MISO_GPIO   19
+#define SPI_SCLK_GPIO   18
+#define SPI_CS_GPIO     5
+#define SPI_CLK_HZ      8000000     /* the BME680 takes up to 10 MHz */
+
+/* Add a sensor on SPI to the sensor table */
+#ifndef BME680_USE_SPI
+#define BME680_USE_SPI  0
+#endif
+
+/* Sensors the registry can hold: two addresses on each of the two I2C ports, plus SPI */
+#ifndef BME680_MAX_SENSORS
+#define BME680_MAX_SENSORS          (4 + BME680_USE_SPI)
+#endif
+
+/* Driver waits up to this long spin, longer ones sleep on a one-shot timer. One tick by default:
+ * below it the task switch costs about as much as the wait */
+#ifndef BME680_DELAY_SPIN_MAX_US
+#define BME680_DELAY_SPIN_MAX_US    (1000000U / configTICK_RATE_HZ)
+#endif
+
 /* ----- BME680 Info ----- */
 #define BME680_I2C_ADDR_0           0x76
 #define BME680_I2C_ADDR_1           0x77
@@ -31,14 +73,134 @@
 #define BME680_REG_CTRL_MEAS        0x74
 #define BME680_REG_CONFIG           0x75
 
-/* I2C context for BME680 */
-struct bme68x_i2c_ctx {
-    i2c_master_bus_handle_t bus;
+/* ----- Calibration cache ----- */
+#define BME680_NVS_NAMESPACE        "bme68x"
+#define BME680_NVS_KEY_CALIB        "calib"
+
+/* ----- Self-test ----- */
+#define BME680_NVS_KEY_SELFTEST     "selftest"
+#define BME680_SELFTEST_MAGIC       0x53544631u
+#define BME680_SELFTEST_NOT_RUN     INT8_C(127)
+
+/* Boots between two full self-tests, the quick one runs on every boot */
+#ifndef BME680_SELFTEST_FULL_EVERY_N_BOOTS
+#define BME680_SELFTEST_FULL_EVERY_N_BOOTS  100
+#endif
+
+/* Self-test results, kept in RTC memory and NVS. Times are time() seconds */
+typedef struct {
+    uint32_t magic;
+    int8_t quick_rslt;
+    int8_t full_rslt;           /* BME680_SELFTEST_NOT_RUN until the first full test */
+    uint16_t boots_since_full;
+    int64_t quick_time_s;
+    int64_t full_time_s;
+} bme680_selftest_record_t;
+
+/* Where a sensor sits */
+typedef struct {
+    enum bme68x_intf intf;          /* BME68X_I2C_INTF or BME68X_SPI_INTF */
+
+    /* I2C: port, pins of that port and 7-bit address */
+    i2c_port_num_t port;
+    int sda_gpio;
+    int scl_gpio;
+    uint8_t addr;
+
+    /* SPI: host, pins of that host and chip select */
+    spi_host_device_t spi_host;
+    int mosi_gpio;
+    int miso_gpio;
+    int sclk_gpio;
+    int cs_gpio;
+} bme680_sensor_cfg_t;
+
+/* Completion of a queued I2C transaction, called from the I2C ISR: keep it short and IRAM safe when
+ * CONFIG_I2C_ISR_IRAM_SAFE is set. Returns true when it woke a higher priority task */
+typedef bool (*bme680_xfer_cb_t)(struct bme68x_dev *handle, esp_err_t err, void *arg);
+
+/* A transaction queued on an asynchronous I2C bus */
+struct bme68x_xfer {
+    uint8_t reg_addr;               /* address byte, sent after the call that queued it returned */
+    struct bme68x_dev *handle;
+    bme680_xfer_cb_t cb;            /* NULL for the blocking driver hooks */
+    void *arg;
+};
+
+/* Bus context for BME680, I2C or SPI */
+struct bme68x_bus_ctx {
+    i2c_master_bus_handle_t bus;    /* shared by the sensors of a port */
+    bool bus_owner;                 /* this sensor created its I2C or SPI bus, no sensor before it is on it */
     i2c_master_dev_handle_t dev;
+    spi_device_handle_t spi;
+    uint8_t id;                     /* position in the sensor table, selects the calibration cache and self-test record */
+
+    /* I2C transactions complete in the ISR, in the order they were queued. One slot stays free */
+    bool async;
+    struct bme68x_xfer xfer[BME680_I2C_QUEUE_DEPTH + 1];
+    volatile uint8_t xfer_head;     /* next slot to queue, task side */
+    volatile uint8_t xfer_tail;     /* next slot to complete, ISR side */
+    volatile esp_err_t xfer_err;    /* first failure since the last wait */
+
+    /* Long driver waits: the timer notifies the task that started it */
+    esp_timer_handle_t delay_timer;
+    TaskHandle_t delay_task;
+    volatile bool delay_done;
 };
 
 
 /* ----------------- Public Functions ----------------- */
-esp_err_t bm68x_i2c_init_itf(struct bme68x_dev *handle, struct bme68x_i2c_ctx *ctx);
+/* Add the sensor at cfg to the bus of its port, creating the bus for the first sensor of the port */
+esp_err_t bm68x_i2c_init_itf(struct bme68x_dev *handle, struct bme68x_bus_ctx *ctx, const bme680_sensor_cfg_t *cfg);
+
+/* Queue a read of length bytes from reg_addr and return right away. cb (may be NULL) runs once reg_data holds
+ * them, reg_data must stay valid until then. ESP_ERR_NOT_SUPPORTED when the bus has no transaction queue,
+ * ESP_ERR_INVALID_STATE when BME680_I2C_QUEUE_DEPTH transactions of this sensor are still in flight. The IDF
+ * queue behind it is per bus: transactions of the other sensors of the port take room in it too, and the IDF
+ * driver's error is returned when it has none left */
+esp_err_t bme680_i2c_read_async(struct bme68x_dev *handle, uint8_t reg_addr, uint8_t *reg_data, uint32_t length,
+                                bme680_xfer_cb_t cb, void *arg);
+
+/* Queue a write like the driver's write hook: data of reg_addr, then address/data pairs. Same rules as reads */
+esp_err_t bme680_i2c_write_async(struct bme68x_dev *handle, uint8_t reg_addr, const uint8_t *reg_data,
+                                 uint32_t length, bme680_xfer_cb_t cb, void *arg);
+
+/* Wait until the transactions queued on the bus of handle are done, those of the other sensors of the port
+ * included. Returns the first failure of the sensor's own transactions since the last wait */
+esp_err_t bme680_i2c_wait(struct bme68x_dev *handle, int timeout_ms);
+
+/* Add the sensor at cfg to the SPI bus of its host, initializing the bus for the first sensor of the host */
+esp_err_t bm68x_spi_init_itf(struct bme68x_dev *handle, struct bme68x_bus_ctx *ctx, const bme680_sensor_cfg_t *cfg);
+
+/* Probe and initialize the sensors of the table cfg, at most BME680_MAX_SENSORS, and keep the ones that
+ * answer. Needs nvs_flash_init(), returns how many */
+uint8_t bme680_registry_init(const bme680_sensor_cfg_t *cfg, uint8_t n_cfg);
+
+/* Number of sensors in the registry */
+uint8_t bme680_registry_count(void);
+
+/* Sensor at index of the registry, 0 .. bme680_registry_count() - 1. The index only counts the sensors that
+ * answered, refer bme680_sensor_id() for the id to report */
+struct bme68x_dev *bme680_registry_get(uint8_t index);
+
+/* Id of a sensor: its position in the sensor table, which stays the same when sensors before it are missing.
+ * The calibration cache, the self-test records and the samples all use it. 0 for a handle set up outside of
+ * the registry */
+uint8_t bme680_sensor_id(const struct bme68x_dev *handle);
+
+/* bme68x_init() with the calibration cached in RTC memory and NVS, needs nvs_flash_init() */
+int8_t bme68x_init_fast(struct bme68x_dev *handle);
+
+/* Quick self-test for boot, the result is recorded */
+int8_t bme68x_selftest_boot(struct bme68x_dev *handle);
+
+/* True when the full self-test did not run this boot and never passed or is BME680_SELFTEST_FULL_EVERY_N_BOOTS old */
+bool bme68x_selftest_full_due(const struct bme68x_dev *handle);
+
+/* Full self-test, sleeps through the heater steps. Resets the sensor: configure it again afterwards */
+int8_t bme68x_selftest_full(struct bme68x_dev *handle);
+
+/* Last recorded self-test results */
+const bme680_selftest_record_t *bme68x_selftest_record(const struct bme68x_dev *handle);
 
 #endif //LAERA_FW_DRV_BME680_H
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+ * Counts heap calls made while the driver runs against the simulated sensor
+ * for a long time: init, then forced samples through bme68x_get_data() and
+ * the asynchronous API with a configuration switch every sample, then
+ * parallel mode. The sampling paths must not touch the heap at all.
+ *
+ * malloc, calloc, realloc and free are wrapped at link time (-Wl,--wrap), so
+ * only calls from the driver, the simulator and this file are counted, not
+ * the ones inside libc.
+ *
+ * Usage: alloc_test_{int,fpu} [n_samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bme68x.h"
+#include "bme680_sim.h"
+
+#define N_SAMPLES_DEFAULT   1000000u
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+/* volatile: the compiler assumes malloc and free leave the program's globals alone */
+static volatile uint32_t n_alloc;
+static volatile uint32_t n_free;
+
+void *__wrap_malloc(size_t size)
+{
+    n_alloc++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+    n_alloc++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    n_alloc++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        n_free++;
+    }
+    __real_free(ptr);
+}
+
+static struct bme680_sim sim;
+static struct bme68x_dev dev;
+
+/* Print the heap calls of one phase, non-zero when there were any */
+static int report(const char *phase, uint32_t n_samples, uint32_t alloc0, uint32_t free0)
+{
+    uint32_t a = n_alloc - alloc0, f = n_free - free0;
+
+    printf("  %-9s %7u samples, %u allocations, %u frees\n", phase, n_samples, a, f);
+    return (a || f) ? 1 : 0;
+}
+
+/* bme68x_get_data() after a blocking forced measurement, alternating two compiled configurations */
+static int run_forced(uint32_t n, const struct bme68x_conf_image *image, struct bme68x_conf *conf,
+                      const struct bme68x_heatr_conf *heatr_conf)
+{
+    struct bme68x_data data;
+    uint32_t a = n_alloc, f = n_free, got = 0;
+    uint8_t n_data;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (bme68x_set_conf_image(&image[i % 2], &dev) || bme68x_set_op_mode(BME68X_FORCED_MODE, &dev)) {
+            return 1;
+        }
+        dev.delay_us(bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf[i % 2], &dev) +
+                     heatr_conf[i % 2].heatr_dur * 1000u, dev.intf_ptr);
+        if (bme68x_get_data(BME68X_FORCED_MODE, &data, &n_data, &dev) == BME68X_OK && n_data) {
+            got++;
+        }
+    }
+
+    return report("forced", got, a, f) || got != n;
+}
+
+/* Forced mode through bme68x_async_*, the test does the waiting */
+static int run_async(uint32_t n, struct bme68x_conf *conf, const struct bme68x_heatr_conf *heatr_conf)
+{
+    struct bme68x_async meas = { 0 };
+    uint32_t meas_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, conf, &dev) + heatr_conf->heatr_dur * 1000u;
+    uint32_t a = n_alloc, f = n_free, got = 0;
+    int8_t rslt;
+
+    if (bme68x_set_conf(conf, &dev) ||
+        bme68x_set_heatr_conf(BME68X_FORCED_MODE, heatr_conf, &dev)) {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        rslt = bme68x_async_start(BME68X_FORCED_MODE, meas_us, &meas, &dev);
+        while (rslt == BME68X_W_ASYNC_BUSY) {
+            bme680_sim_advance(&sim, meas.wait_us);
+            rslt = bme68x_async_step(&meas, &dev);
+        }
+        if (rslt == BME68X_OK && meas.n_data) {
+            got++;
+        }
+    }
+
+    return report("async", got, a, f) || got != n;
+}
+
+/* Parallel mode, read once per step */
+static int run_parallel(uint32_t n)
+{
+    static uint16_t temp_prof[] = { 320 };
+    static uint16_t mul_prof[] = { 1 };
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X, .os_temp = BME68X_OS_2X, .os_pres = BME68X_OS_1X,
+        .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE, .heatr_temp_prof = temp_prof, .heatr_dur_prof = mul_prof,
+        .profile_len = 1, .shared_heatr_dur = 100,
+    };
+    struct bme68x_data data[3];
+    uint32_t step_us, a = n_alloc, f = n_free, got = 0;
+    uint8_t n_data;
+
+    if (bme68x_set_conf(&conf, &dev) || bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr_conf, &dev) ||
+        bme68x_set_op_mode(BME68X_PARALLEL_MODE, &dev)) {
+        return 1;
+    }
+
+    step_us = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &dev) + heatr_conf.shared_heatr_dur * 1000u;
+    while (got < n) {
+        bme680_sim_advance(&sim, step_us);
+        if (bme68x_get_data(BME68X_PARALLEL_MODE, data, &n_data, &dev) == BME68X_OK) {
+            got += n_data;
+        }
+    }
+
+    return report("parallel", got, a, f) || bme68x_set_op_mode(BME68X_SLEEP_MODE, &dev);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_SAMPLES_DEFAULT;
+    struct bme68x_conf conf[2] = {
+        { .os_hum = BME68X_OS_1X, .os_temp = BME68X_OS_2X, .os_pres = BME68X_OS_1X,
+          .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE },
+        { .os_hum = BME68X_OS_2X, .os_temp = BME68X_OS_4X, .os_pres = BME68X_OS_4X,
+          .filter = BME68X_FILTER_SIZE_3, .odr = BME68X_ODR_NONE },
+    };
+    struct bme68x_heatr_conf heatr_conf[2] = {
+        { .enable = BME68X_ENABLE, .heatr_temp = 200, .heatr_dur = 50 },
+        { .enable = BME68X_ENABLE, .heatr_temp = 320, .heatr_dur = 100 },
+    };
+    struct bme68x_conf_image image[2];
+    void *volatile probe;
+    uint32_t a, f;
+    int rslt = 0;
+
+    /* The counter itself works */
+    a = n_alloc;
+    probe = malloc(1);
+    free(probe);
+    if (n_alloc != a + 1) {
+        printf("malloc is not wrapped\n");
+        return 1;
+    }
+
+    printf("heap calls\n");
+    a = n_alloc;
+    f = n_free;
+    bme680_sim_init(&sim, BME68X_VARIANT_GAS_HIGH);
+    bme680_sim_attach(&sim, &dev);
+    dev.amb_temp = 25;
+    dev.shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL;
+    if (bme68x_init(&dev) != BME68X_OK) {
+        printf("bme68x_init failed\n");
+        return 1;
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        if (bme68x_compile_conf(BME68X_FORCED_MODE, &conf[i], &heatr_conf[i], &image[i], &dev)) {
+            return 1;
+        }
+    }
+    rslt |= report("init", 0, a, f);
+
+    rslt |= run_forced(n, image, conf, heatr_conf);
+    rslt |= run_async(n, &conf[1], &heatr_conf[1]);
+    rslt |= run_parallel(n);
+
+    printf("%s\n", rslt ? "FAIL" : "OK");
+    return rslt;
+}
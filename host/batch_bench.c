@@ -0,0 +1,175 @@
+/*
+ * Batch compensation benchmark.
+ *
+ * Compensates a synthetic log of raw samples three ways and reports samples
+ * per second: one bme68x_compensate_raw() call per sample, one
+ * bme68x_compensate_batch() call, and bme68x_compensate_batch_mt(). Every
+ * batch result is checked against the per-sample result.
+ *
+ * Usage: batch_bench_{int,fpu} [n_samples] [n_threads]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bme68x.h"
+#include "bme68x_batch_mt.h"
+#include "bme680_sim.h"
+
+#define N_SAMPLES_DEFAULT   (1u << 21)
+
+static uint32_t xorshift32(uint32_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Pack one sample back into the field registers, as the sensor would */
+static void pack_field(struct bme68x_raw_data *f, uint32_t t, uint32_t p, uint16_t h, uint16_t g, uint8_t r)
+{
+    memset(f, 0, sizeof(*f));
+    f->status = BME68X_NEW_DATA_MSK;
+    f->field[2] = (uint8_t)(p >> 12);
+    f->field[3] = (uint8_t)(p >> 4);
+    f->field[4] = (uint8_t)(p << 4);
+    f->field[5] = (uint8_t)(t >> 12);
+    f->field[6] = (uint8_t)(t >> 4);
+    f->field[7] = (uint8_t)(t << 4);
+    f->field[8] = (uint8_t)(h >> 8);
+    f->field[9] = (uint8_t)h;
+    f->field[13] = (uint8_t)(g >> 2);
+    f->field[14] = (uint8_t)((g << 6) | r);
+    f->field[15] = (uint8_t)(g >> 2);
+    f->field[16] = (uint8_t)((g << 6) | r);
+}
+
+/* Count the samples where the batch result differs from the per-sample path */
+static uint32_t check(const struct bme68x_raw_batch *raw,
+                      struct bme68x_data_batch *out,
+                      uint32_t n,
+                      const struct bme68x_calib_data *calib,
+                      uint32_t variant_id)
+{
+    struct bme68x_raw_data frame;
+    struct bme68x_data ref;
+    uint32_t mismatch = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        pack_field(&frame, raw->temp_adc[i], raw->pres_adc[i], raw->hum_adc[i], raw->gas_adc[i], raw->gas_range[i]);
+        bme68x_compensate_raw(&frame, 1, &ref, calib, variant_id);
+        if (ref.temperature != out->temperature[i] || ref.pressure != out->pressure[i] ||
+            ref.humidity != out->humidity[i] || ref.gas_resistance != out->gas_resistance[i]) {
+            mismatch++;
+        }
+        out->temperature[i] = 0;
+    }
+
+    return mismatch;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_SAMPLES_DEFAULT;
+    unsigned n_threads = (argc > 2) ? (unsigned)strtoul(argv[2], NULL, 0) : 0;
+    struct bme68x_dev dev = { 0 };
+    struct bme680_sim sim;
+    struct bme68x_raw_batch raw;
+    struct bme68x_data_batch out;
+    struct bme68x_raw_data frame;
+    struct bme68x_data ref;
+    uint32_t *temp_adc, *pres_adc, seed = 0x2545f491u;
+    uint16_t *hum_adc, *gas_adc;
+    uint8_t *gas_range;
+    uint32_t mismatch = 0;
+    double t0, t_single, t_batch, t_mt;
+
+    bme680_sim_init(&sim, BME68X_VARIANT_GAS_LOW);
+    bme680_sim_attach(&sim, &dev);
+    dev.amb_temp = 25;
+    if (bme68x_init(&dev) != BME68X_OK) {
+        fprintf(stderr, "bme68x_init failed\n");
+        return 1;
+    }
+
+    temp_adc = malloc(n * sizeof(*temp_adc));
+    pres_adc = malloc(n * sizeof(*pres_adc));
+    hum_adc = malloc(n * sizeof(*hum_adc));
+    gas_adc = malloc(n * sizeof(*gas_adc));
+    gas_range = malloc(n);
+    out.temperature = malloc(n * sizeof(*out.temperature));
+    out.pressure = malloc(n * sizeof(*out.pressure));
+    out.humidity = malloc(n * sizeof(*out.humidity));
+    out.gas_resistance = malloc(n * sizeof(*out.gas_resistance));
+    if (!temp_adc || !pres_adc || !hum_adc || !gas_adc || !gas_range || !out.temperature || !out.pressure ||
+        !out.humidity || !out.gas_resistance) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    /* Roughly -10..60 degC, 300..1100 hPa, full humidity and gas range */
+    for (uint32_t i = 0; i < n; i++) {
+        temp_adc[i] = 380000u + xorshift32(&seed) % 260000u;
+        pres_adc[i] = 150000u + xorshift32(&seed) % 400000u;
+        hum_adc[i] = (uint16_t)(10000u + xorshift32(&seed) % 30000u);
+        gas_adc[i] = (uint16_t)(xorshift32(&seed) & 0x3ffu);
+        gas_range[i] = (uint8_t)(xorshift32(&seed) & 0x0fu);
+    }
+    raw.temp_adc = temp_adc;
+    raw.pres_adc = pres_adc;
+    raw.hum_adc = hum_adc;
+    raw.gas_adc = gas_adc;
+    raw.gas_range = gas_range;
+
+    t0 = now_s();
+    for (uint32_t i = 0; i < n; i++) {
+        pack_field(&frame, temp_adc[i], pres_adc[i], hum_adc[i], gas_adc[i], gas_range[i]);
+        bme68x_compensate_raw(&frame, 1, &ref, &dev.calib, dev.variant_id);
+        out.temperature[i] = ref.temperature;
+    }
+    t_single = now_s() - t0;
+
+    t0 = now_s();
+    bme68x_compensate_batch(&raw, &out, n, &dev.calib, dev.variant_id);
+    t_batch = now_s() - t0;
+    mismatch += check(&raw, &out, n, &dev.calib, dev.variant_id);
+
+    t0 = now_s();
+    bme68x_compensate_batch_mt(&raw, &out, n, &dev.calib, dev.variant_id, n_threads);
+    t_mt = now_s() - t0;
+    mismatch += check(&raw, &out, n, &dev.calib, dev.variant_id);
+
+#ifndef BME68X_USE_FPU
+    printf("build       : INT\n");
+#else
+    printf("build       : FPU\n");
+#endif
+    printf("samples     : %u\n", n);
+    printf("mismatches  : %u\n", mismatch);
+    printf("per sample  : %8.2f Msamples/s\n", n / t_single * 1e-6);
+    printf("batch       : %8.2f Msamples/s\n", n / t_batch * 1e-6);
+    printf("batch mt    : %8.2f Msamples/s\n", n / t_mt * 1e-6);
+
+    free(temp_adc);
+    free(pres_adc);
+    free(hum_adc);
+    free(gas_adc);
+    free(gas_range);
+    free(out.temperature);
+    free(out.pressure);
+    free(out.humidity);
+    free(out.gas_resistance);
+
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+#include <string.h>
+
+#include "bme680_sim.h"
+
+/* Status bits of MEAS_STATUS_x, besides new_data and the gas index */
+#define SIM_GAS_MEASURING   0x40
+#define SIM_MEASURING       0x20
+
+/* Time base of the shared heater duration register, parallel mode */
+#define SIM_SHD_HEATR_STEP_US   477u
+
+/* Heater current reported in IDAC_HEAT_x after a heated measurement */
+#define SIM_IDAC_HEAT           0x3a
+
+enum {
+    SIM_IDLE = 0,
+    SIM_STANDBY,
+    SIM_MEASURING_STATE
+};
+
+/* Calibration block typical of a BME680, as laid out in the register map */
+static const uint8_t sim_coeff1[BME68X_LEN_COEFF1] = {
+    0xe5, 0x66, 0x03, 0x00, 0x05, 0x8e, 0x54, 0xd7, 0x58, 0x00, 0x3e, 0x1a, 0x74, 0xff, 0x26, 0x1e,
+    0x00, 0x00, 0x11, 0xf2, 0x5c, 0xf4, 0x1e
+};
+static const uint8_t sim_coeff2[BME68X_LEN_COEFF2] = {
+    0x3f, 0x43, 0x31, 0x00, 0x2d, 0x14, 0x78, 0x9c, 0xcc, 0x65, 0x15, 0xcf, 0xe2, 0x12
+};
+static const uint8_t sim_coeff3[BME68X_LEN_COEFF3] = {
+    0x2c, 0x00, 0x16, 0x00, 0x20
+};
+
+/* Roughly 25 degC, 1000 hPa, 40 %rH with this calibration */
+static const struct bme680_sim_env sim_env_default = {
+    .temp_adc = 510000,
+    .pres_adc = 345000,
+    .hum_adc = 21000,
+    .gas_adc = 600,
+    .gas_range = 5,
+};
+
+static uint8_t reg(const struct bme680_sim *sim, uint8_t addr)
+{
+    return sim->regs[addr];
+}
+
+/* gas_wait_x encoding: 6 bit value times 1, 4, 16 or 64 */
+static uint32_t decode_wait(uint8_t val)
+{
+    static const uint8_t mult[4] = { 1, 4, 16, 64 };
+
+    return (uint32_t)(val & 0x3f) * mult[val >> 6];
+}
+
+static uint8_t run_gas(const struct bme680_sim *sim)
+{
+    uint8_t run = (reg(sim, BME68X_REG_CTRL_GAS_1) & BME68X_RUN_GAS_MSK) >> BME68X_RUN_GAS_POS;
+    uint8_t want = (reg(sim, BME68X_REG_VARIANT_ID) == BME68X_VARIANT_GAS_HIGH) ?
+                   BME68X_ENABLE_GAS_MEAS_H : BME68X_ENABLE_GAS_MEAS_L;
+
+    return run == want;
+}
+
+static uint8_t heater_on(const struct bme680_sim *sim)
+{
+    return !(reg(sim, BME68X_REG_CTRL_GAS_0) & BME68X_HCTRL_MSK);
+}
+
+static uint8_t profile_len(const struct bme680_sim *sim)
+{
+    uint8_t len = reg(sim, BME68X_REG_CTRL_GAS_1) & BME68X_NBCONV_MSK;
+
+    if (sim->mode == BME68X_FORCED_MODE || len == 0) {
+        return 1;
+    }
+    return (len > 10) ? 10 : len;
+}
+
+/* TPH conversion time, same model as bme68x_get_meas_dur() */
+static uint32_t tph_us(const struct bme680_sim *sim)
+{
+    static const uint8_t cycles[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+    uint8_t ctrl_meas = reg(sim, BME68X_REG_CTRL_MEAS);
+    uint32_t us;
+
+    us = cycles[ctrl_meas >> 5] + cycles[(ctrl_meas >> 2) & 0x07] + cycles[reg(sim, BME68X_REG_CTRL_HUM) & 0x07];
+    us = us * 1963u + 477u * 4u + 477u * 5u;
+    if (sim->mode != BME68X_PARALLEL_MODE) {
+        us += 1000u;
+    }
+    return us;
+}
+
+/* Duration of the measurement producing the next result */
+static uint32_t meas_us(const struct bme680_sim *sim)
+{
+    uint32_t us = tph_us(sim);
+
+    if (!run_gas(sim)) {
+        return us;
+    }
+    if (sim->mode == BME68X_PARALLEL_MODE) {
+        us += decode_wait(reg(sim, BME68X_REG_SHD_HEATR_DUR)) * SIM_SHD_HEATR_STEP_US;
+    } else {
+        us += decode_wait(reg(sim, BME68X_REG_GAS_WAIT0 + sim->gas_index)) * 1000u;
+    }
+    return us;
+}
+
+/* Standby between two results in sequential and parallel mode */
+static uint32_t odr_us(const struct bme680_sim *sim)
+{
+    static const uint32_t standby[8] = { 590, 62500, 125000, 250000, 500000, 1000000, 10000, 20000 };
+
+    if (reg(sim, BME68X_REG_CTRL_GAS_1) & BME68X_ODR3_MSK) {
+        return 0;
+    }
+    return standby[reg(sim, BME68X_REG_CONFIG) >> BME68X_ODR20_POS];
+}
+
+static uint8_t *field(struct bme680_sim *sim, uint8_t slot)
+{
+    return &sim->regs[BME68X_REG_FIELD0 + slot * BME68X_LEN_FIELD_OFFSET];
+}
+
+static void start_meas(struct bme680_sim *sim, uint64_t at_us)
+{
+    uint8_t *f = field(sim, sim->slot);
+
+    sim->state_end_us = at_us + meas_us(sim);
+    sim->state = SIM_MEASURING_STATE;
+    f[0] = (uint8_t)(SIM_MEASURING | (run_gas(sim) ? SIM_GAS_MEASURING : 0) | sim->gas_index);
+}
+
+static void finish_meas(struct bme680_sim *sim)
+{
+    struct bme680_sim_env env = sim->env;
+    uint8_t *f = field(sim, sim->slot);
+    uint8_t gas_stat = 0;
+    uint8_t gas_off;
+
+    sim->n_meas++;
+    if (sim->on_measure) {
+        sim->on_measure(sim, sim->gas_index, &env);
+    }
+
+    if (run_gas(sim)) {
+        gas_stat |= BME68X_GASM_VALID_MSK;
+        if (heater_on(sim) && reg(sim, BME68X_REG_RES_HEAT0 + sim->gas_index) &&
+            (sim->mode == BME68X_PARALLEL_MODE || reg(sim, BME68X_REG_GAS_WAIT0 + sim->gas_index))) {
+            gas_stat |= BME68X_HEAT_STAB_MSK;
+
+            /* The heater reports the current it settled on unless one was set */
+            if (!reg(sim, BME68X_REG_IDAC_HEAT0 + sim->gas_index)) {
+                sim->regs[BME68X_REG_IDAC_HEAT0 + sim->gas_index] = SIM_IDAC_HEAT;
+            }
+        }
+    }
+
+    memset(f, 0, BME68X_LEN_FIELD);
+    f[0] = (uint8_t)(BME68X_NEW_DATA_MSK | sim->gas_index);
+    f[1] = sim->meas_index++;
+    f[2] = (uint8_t)(env.pres_adc >> 12);
+    f[3] = (uint8_t)(env.pres_adc >> 4);
+    f[4] = (uint8_t)(env.pres_adc << 4);
+    f[5] = (uint8_t)(env.temp_adc >> 12);
+    f[6] = (uint8_t)(env.temp_adc >> 4);
+    f[7] = (uint8_t)(env.temp_adc << 4);
+    f[8] = (uint8_t)(env.hum_adc >> 8);
+    f[9] = (uint8_t)env.hum_adc;
+
+    /* BME680 reports gas in gas_r_lsb/msb at 0x2a, BME688 at 0x2c */
+    gas_off = (reg(sim, BME68X_REG_VARIANT_ID) == BME68X_VARIANT_GAS_HIGH) ? 15 : 13;
+    f[gas_off] = (uint8_t)(env.gas_adc >> 2);
+    f[gas_off + 1] = (uint8_t)((env.gas_adc << 6) | gas_stat | (env.gas_range & BME68X_GAS_RANGE_MSK));
+
+    if (sim->mode == BME68X_FORCED_MODE) {
+        /* Back to sleep once the single measurement is done */
+        sim->regs[BME68X_REG_CTRL_MEAS] &= (uint8_t)~BME68X_MODE_MSK;
+        sim->mode = BME68X_SLEEP_MODE;
+        sim->state = SIM_IDLE;
+        return;
+    }
+
+    /* Next heater step and next field slot, then standby until the next result */
+    sim->gas_index = (uint8_t)((sim->gas_index + 1) % profile_len(sim));
+    sim->slot = (uint8_t)((sim->slot + 1) % 3);
+    sim->state = SIM_STANDBY;
+    sim->state_end_us = sim->now_us + odr_us(sim);
+}
+
+static void run(struct bme680_sim *sim, uint64_t until_us)
+{
+    while (sim->state != SIM_IDLE && sim->state_end_us <= until_us) {
+        sim->now_us = sim->state_end_us;
+        if (sim->state == SIM_MEASURING_STATE) {
+            finish_meas(sim);
+        } else {
+            start_meas(sim, sim->now_us);
+        }
+    }
+    sim->now_us = until_us;
+}
+
+static void set_mode(struct bme680_sim *sim, uint8_t mode)
+{
+    if (mode == BME68X_SLEEP_MODE) {
+        sim->mode = BME68X_SLEEP_MODE;
+        sim->state = SIM_IDLE;
+        return;
+    }
+
+    /* A new mode restarts the profile, the slot rotation carries on */
+    if (mode != sim->mode || sim->state == SIM_IDLE) {
+        sim->mode = mode;
+        sim->gas_index = 0;
+        if (mode == BME68X_FORCED_MODE) {
+            sim->slot = 0;
+        }
+        start_meas(sim, sim->now_us);
+    }
+}
+
+static void soft_reset(struct bme680_sim *sim)
+{
+    memset(&sim->regs[BME68X_REG_FIELD0], 0, BME68X_LEN_FIELD_OFFSET * 3);
+    memset(&sim->regs[BME68X_REG_IDAC_HEAT0], 0, BME68X_REG_CONFIG - BME68X_REG_IDAC_HEAT0 + 1);
+    sim->mode = BME68X_SLEEP_MODE;
+    sim->state = SIM_IDLE;
+    sim->slot = 0;
+    sim->gas_index = 0;
+    sim->meas_index = 0;
+    sim->spi_page = 0;
+}
+
+static void write_reg(struct bme680_sim *sim, uint8_t addr, uint8_t val)
+{
+    if (sim->spi && addr == BME68X_REG_MEM_PAGE) {
+        sim->spi_page = val & BME68X_MEM_PAGE_MSK;
+        return;
+    }
+
+    if (addr == BME68X_REG_SOFT_RESET) {
+        if (val == BME68X_SOFT_RESET_CMD) {
+            soft_reset(sim);
+        }
+        return;
+    }
+
+    /* Only the control block is writable, the rest is read-only */
+    if (addr < BME68X_REG_IDAC_HEAT0 || addr > BME68X_REG_CONFIG) {
+        return;
+    }
+
+    sim->regs[addr] = val;
+    if (addr == BME68X_REG_CTRL_MEAS) {
+        set_mode(sim, val & BME68X_MODE_MSK);
+    }
+}
+
+/* Register of the I2C map behind a bus address. On SPI page 0 holds 0x80..0xff and page 1 0x00..0x7f,
+ * the status register is in both */
+static uint8_t bus_reg(const struct bme680_sim *sim, uint8_t addr)
+{
+    if (!sim->spi) {
+        return addr;
+    }
+
+    addr &= BME68X_SPI_WR_MSK;
+    if (addr == (BME68X_REG_MEM_PAGE & BME68X_SPI_WR_MSK)) {
+        return BME68X_REG_MEM_PAGE;
+    }
+    return (sim->spi_page & BME68X_MEM_PAGE_MSK) ? addr : (uint8_t)(addr | 0x80);
+}
+
+static uint8_t read_reg(const struct bme680_sim *sim, uint8_t addr)
+{
+    if (sim->spi && addr == BME68X_REG_MEM_PAGE) {
+        return sim->spi_page;
+    }
+    return sim->regs[addr];
+}
+
+/* Charge bus time and fail the transaction when asked to */
+static int8_t transaction(struct bme680_sim *sim, uint32_t n_bytes)
+{
+    if (sim->bus_us_per_byte) {
+        run(sim, sim->now_us + (uint64_t)n_bytes * sim->bus_us_per_byte);
+    }
+    if (sim->fail_next) {
+        sim->fail_next--;
+        return -1;
+    }
+    return 0;
+}
+
+void bme680_sim_init(struct bme680_sim *sim, uint8_t variant)
+{
+    memset(sim, 0, sizeof(*sim));
+    memcpy(&sim->regs[BME68X_REG_COEFF1], sim_coeff1, sizeof(sim_coeff1));
+    memcpy(&sim->regs[BME68X_REG_COEFF2], sim_coeff2, sizeof(sim_coeff2));
+    memcpy(&sim->regs[BME68X_REG_COEFF3], sim_coeff3, sizeof(sim_coeff3));
+    sim->regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+    sim->regs[BME68X_REG_VARIANT_ID] = variant;
+    sim->env = sim_env_default;
+    soft_reset(sim);
+}
+
+void bme680_sim_attach(struct bme680_sim *sim, struct bme68x_dev *dev)
+{
+    dev->intf = sim->spi ? BME68X_SPI_INTF : BME68X_I2C_INTF;
+    dev->intf_ptr = sim;
+    dev->read = bme680_sim_read;
+    dev->write = bme680_sim_write;
+    dev->delay_us = bme680_sim_delay_us;
+}
+
+void bme680_sim_advance(struct bme680_sim *sim, uint64_t us)
+{
+    run(sim, sim->now_us + us);
+}
+
+BME68X_INTF_RET_TYPE bme680_sim_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    struct bme680_sim *sim = intf_ptr;
+
+    sim->n_read++;
+    sim->n_read_bytes += length + 1;
+    if (transaction(sim, length + 1)) {
+        return (BME68X_INTF_RET_TYPE)-1;
+    }
+
+    for (uint32_t i = 0; i < length; i++) {
+        reg_data[i] = read_reg(sim, bus_reg(sim, (uint8_t)(reg_addr + i)));
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+/*
+ * The driver sends address/value pairs: reg_addr, data[0], then
+ * data[1]/data[2], data[3]/data[4]... as bme68x_set_regs() interleaves them.
+ */
+BME68X_INTF_RET_TYPE bme680_sim_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    struct bme680_sim *sim = intf_ptr;
+
+    sim->n_write++;
+    sim->n_write_bytes += length + 1;
+    if (transaction(sim, length + 1)) {
+        return (BME68X_INTF_RET_TYPE)-1;
+    }
+
+    write_reg(sim, bus_reg(sim, reg_addr), reg_data[0]);
+    for (uint32_t i = 1; i + 1 < length; i += 2) {
+        write_reg(sim, bus_reg(sim, reg_data[i]), reg_data[i + 1]);
+    }
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+void bme680_sim_delay_us(uint32_t period, void *intf_ptr)
+{
+    struct bme680_sim *sim = intf_ptr;
+
+    sim->n_delay++;
+    run(sim, sim->now_us + period);
+}
@@ -0,0 +1,85 @@
+//
+// Register-level BME680/BME688 simulator for host builds.
+//
+// The simulator owns a register map and plugs into the bme68x_read_fptr_t,
+// bme68x_write_fptr_t and bme68x_delay_us_fptr_t hooks of struct bme68x_dev.
+// Time is virtual: it only moves when the driver calls delay_us (or when the
+// test calls bme680_sim_advance()), so measurements complete deterministically.
+//
+// Modelled: I2C or SPI with memory pages, chip/variant id, calibration block, soft reset, forced,
+// sequential and parallel mode with heater profiles, field rotation over the
+// three field slots, measurement/ODR timing and per-transaction counters.
+//
+
+#ifndef LAERA_HOST_BME680_SIM_H
+#define LAERA_HOST_BME680_SIM_H
+
+#include <stdint.h>
+
+#include "bme68x_defs.h"
+
+/* Raw values the next measurement reports */
+struct bme680_sim_env {
+    uint32_t temp_adc;  /* 20 bit */
+    uint32_t pres_adc;  /* 20 bit */
+    uint16_t hum_adc;
+    uint16_t gas_adc;   /* 10 bit */
+    uint8_t gas_range;  /* 4 bit */
+};
+
+struct bme680_sim;
+
+/* Called at the end of every measurement, may change env for this one */
+typedef void (*bme680_sim_measure_fn)(struct bme680_sim *sim, uint8_t gas_index, struct bme680_sim_env *env);
+
+struct bme680_sim {
+    uint8_t regs[256];
+
+    /* Measurement state */
+    uint8_t mode;           /* mode the sensor is running in */
+    uint8_t state;          /* idle, standby or measuring */
+    uint8_t slot;           /* field slot the next result goes to, 0..2 */
+    uint8_t gas_index;      /* heater profile step of the next result */
+    uint8_t meas_index;     /* sub_meas_index of the next result */
+    uint64_t state_end_us;  /* end of the current standby or measurement */
+
+    /* Bus: I2C, or 4-wire SPI with the 7-bit address space split in two pages */
+    uint8_t spi;            /* set before bme680_sim_attach() */
+    uint8_t spi_page;       /* spi_mem_page bit of the status register */
+
+    /* Virtual time */
+    uint64_t now_us;
+    uint32_t bus_us_per_byte;   /* bus time charged per byte transferred, 0 = free */
+
+    /* Environment reported by the next measurement */
+    struct bme680_sim_env env;
+    bme680_sim_measure_fn on_measure;
+    void *user;
+
+    /* Counters, never reset by the simulator */
+    uint32_t n_read;
+    uint32_t n_write;
+    uint32_t n_read_bytes;
+    uint32_t n_write_bytes;
+    uint32_t n_delay;
+    uint32_t n_meas;
+
+    /* Fail the next transactions with this many consecutive errors */
+    uint32_t fail_next;
+};
+
+/* Power the simulated sensor on. variant is BME68X_VARIANT_GAS_LOW (BME680) or _HIGH (BME688) */
+void bme680_sim_init(struct bme680_sim *sim, uint8_t variant);
+
+/* Point the bus hooks and interface of dev at the simulator */
+void bme680_sim_attach(struct bme680_sim *sim, struct bme68x_dev *dev);
+
+/* Let virtual time pass */
+void bme680_sim_advance(struct bme680_sim *sim, uint64_t us);
+
+/* Bus hooks, intf_ptr is the struct bme680_sim */
+BME68X_INTF_RET_TYPE bme680_sim_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr);
+BME68X_INTF_RET_TYPE bme680_sim_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr);
+void bme680_sim_delay_us(uint32_t period, void *intf_ptr);
+
+#endif //LAERA_HOST_BME680_SIM_H
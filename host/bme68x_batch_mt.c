@@ -0,0 +1,98 @@
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "bme68x_batch_mt.h"
+
+struct batch_slice {
+    struct bme68x_raw_batch raw;
+    struct bme68x_data_batch data;
+    uint32_t n_data;
+    const struct bme68x_calib_data *calib;
+    uint32_t variant_id;
+    int8_t rslt;
+};
+
+/* Offset every array in use by off samples, NULL arrays stay NULL */
+#define SLICE(p, off) ((p) ? (p) + (off) : NULL)
+
+static void *batch_worker(void *arg)
+{
+    struct batch_slice *s = arg;
+
+    s->rslt = bme68x_compensate_batch(&s->raw, &s->data, s->n_data, s->calib, s->variant_id);
+    return NULL;
+}
+
+int8_t bme68x_compensate_batch_mt(const struct bme68x_raw_batch *raw,
+                                  struct bme68x_data_batch *data,
+                                  uint32_t n_data,
+                                  const struct bme68x_calib_data *calib,
+                                  uint32_t variant_id,
+                                  unsigned n_threads)
+{
+    struct batch_slice slice[BME68X_BATCH_MT_MAX_THREADS];
+    pthread_t tid[BME68X_BATCH_MT_MAX_THREADS];
+    uint8_t started[BME68X_BATCH_MT_MAX_THREADS] = { 0 };
+    uint32_t per_thread, off = 0;
+    int8_t rslt = BME68X_OK;
+
+    if (!raw || !data) {
+        return BME68X_E_NULL_PTR;
+    }
+
+    if (n_threads == 0) {
+        long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n_cpu > 0) ? (unsigned)n_cpu : 1u;
+    }
+    if (n_threads > BME68X_BATCH_MT_MAX_THREADS) {
+        n_threads = BME68X_BATCH_MT_MAX_THREADS;
+    }
+    if (n_threads > n_data / BME68X_BATCH_MT_MIN_SLICE) {
+        n_threads = n_data / BME68X_BATCH_MT_MIN_SLICE;
+    }
+    if (n_threads <= 1) {
+        return bme68x_compensate_batch(raw, data, n_data, calib, variant_id);
+    }
+
+    /* Slices are multiples of the chunk size, the last one takes the rest */
+    per_thread = (n_data / n_threads) & ~(uint32_t)(BME68X_BATCH_CHUNK - 1);
+
+    for (unsigned t = 0; t < n_threads; t++) {
+        struct batch_slice *s = &slice[t];
+
+        s->n_data = (t == n_threads - 1) ? (n_data - off) : per_thread;
+        s->raw.temp_adc = SLICE(raw->temp_adc, off);
+        s->raw.pres_adc = SLICE(raw->pres_adc, off);
+        s->raw.hum_adc = SLICE(raw->hum_adc, off);
+        s->raw.gas_adc = SLICE(raw->gas_adc, off);
+        s->raw.gas_range = SLICE(raw->gas_range, off);
+        s->data.temperature = SLICE(data->temperature, off);
+        s->data.pressure = SLICE(data->pressure, off);
+        s->data.humidity = SLICE(data->humidity, off);
+        s->data.gas_resistance = SLICE(data->gas_resistance, off);
+        s->calib = calib;
+        s->variant_id = variant_id;
+        s->rslt = BME68X_OK;
+        off += s->n_data;
+
+        /* The calling thread takes the last slice itself */
+        if (t < n_threads - 1) {
+            started[t] = (pthread_create(&tid[t], NULL, batch_worker, s) == 0);
+        }
+        if (!started[t]) {
+            batch_worker(s);
+        }
+    }
+
+    for (unsigned t = 0; t < n_threads; t++) {
+        if (started[t]) {
+            pthread_join(tid[t], NULL);
+        }
+        if (slice[t].rslt != BME68X_OK) {
+            rslt = slice[t].rslt;
+        }
+    }
+
+    return rslt;
+}
@@ -0,0 +1,30 @@
+//
+// Host-side helper splitting bme68x_compensate_batch() across threads.
+//
+
+#ifndef LAERA_HOST_BME68X_BATCH_MT_H
+#define LAERA_HOST_BME68X_BATCH_MT_H
+
+#include <stdint.h>
+
+#include "bme68x.h"
+
+/* Below this many samples per thread the split is not worth a thread */
+#define BME68X_BATCH_MT_MIN_SLICE   4096u
+
+/* Upper bound on the number of worker threads */
+#define BME68X_BATCH_MT_MAX_THREADS 64u
+
+/*
+ * Compensate n_data samples like bme68x_compensate_batch(), with the arrays
+ * cut into contiguous slices handed to up to n_threads threads.
+ * n_threads == 0 uses the number of online CPUs.
+ */
+int8_t bme68x_compensate_batch_mt(const struct bme68x_raw_batch *raw,
+                                  struct bme68x_data_batch *data,
+                                  uint32_t n_data,
+                                  const struct bme68x_calib_data *calib,
+                                  uint32_t variant_id,
+                                  unsigned n_threads);
+
+#endif //LAERA_HOST_BME68X_BATCH_MT_H
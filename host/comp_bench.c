@@ -0,0 +1,56 @@
+/*
+ * Host runner for the portable compensation benchmarks in bench/.
+ *
+ * Usage: comp_bench_{int,fpu} golden [out.txt]
+ *        comp_bench_{int,fpu} timing [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bme68x_bench.h"
+
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void emit(const char *line, void *arg)
+{
+    fprintf(arg, "%s\n", line);
+}
+
+int main(int argc, char **argv)
+{
+    struct bme68x_bench_cfg cfg = {
+        .clock_ns = clock_ns,
+        .emit = emit,
+        .arg = stdout,
+    };
+
+    if (argc > 1 && !strcmp(argv[1], "golden")) {
+        int32_t n;
+
+        if (argc > 2 && !(cfg.arg = fopen(argv[2], "w"))) {
+            fprintf(stderr, "cannot open %s\n", argv[2]);
+            return 1;
+        }
+        n = bme68x_bench_golden(&cfg);
+        if (cfg.arg != stdout) {
+            fclose(cfg.arg);
+        }
+        return (n > 0) ? 0 : 1;
+    }
+    if (argc > 1 && !strcmp(argv[1], "timing")) {
+        cfg.rounds = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 0;
+        return (bme68x_bench_timing(&cfg) == 0) ? 0 : 1;
+    }
+
+    fprintf(stderr, "usage: %s golden [out.txt] | timing [rounds]\n", argv[0]);
+    return 2;
+}
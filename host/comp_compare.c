@@ -0,0 +1,125 @@
+/*
+ * Compares the golden outputs of two builds, e.g. INT against FPU, and
+ * reports the error per quantity.
+ *
+ * Usage: comp_compare <reference.txt> <other.txt>
+ *
+ * Both files come from bme68x_bench_golden() and must hold the same vectors
+ * in the same order. The first file is the reference. Vectors whose
+ * reference value lies outside the operating range of the sensor, or on a
+ * clamp, are reported apart: the sweeps reach past the datasheet range on
+ * purpose, to show where a build stops being usable.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N_QUANTITIES    5
+
+struct err_stats {
+    const char *name;
+    const char *unit;
+    double lo, hi;      /* operating range, exclusive */
+    unsigned long n;
+    double sum_abs;
+    double max_abs;
+    double max_rel;
+    char max_at[64];
+    unsigned long n_out;
+    double max_abs_out;
+};
+
+static struct err_stats stats[N_QUANTITIES] = {
+    { .name = "T", .unit = "degC", .lo = -40.0, .hi = 85.0 },
+    { .name = "P", .unit = "Pa", .lo = 30000.0, .hi = 110000.0 },
+    { .name = "H", .unit = "%RH", .lo = 0.0, .hi = 100.0 },
+    { .name = "GL", .unit = "Ohm", .lo = 0.0, .hi = 1e12 },
+    { .name = "GH", .unit = "Ohm", .lo = 0.0, .hi = 1e12 },
+};
+
+static struct err_stats *find(const char *q)
+{
+    for (int i = 0; i < N_QUANTITIES; i++) {
+        if (!strcmp(stats[i].name, q)) {
+            return &stats[i];
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fa, *fb;
+    char qa[8], qb[8];
+    unsigned calib_a, calib_b;
+    unsigned long idx_a, idx_b, adc_a, adc_b, aux_a, aux_b, line = 0;
+    double va, vb;
+    int ra, rb;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <reference.txt> <other.txt>\n", argv[0]);
+        return 2;
+    }
+    fa = fopen(argv[1], "r");
+    fb = fopen(argv[2], "r");
+    if (!fa || !fb) {
+        fprintf(stderr, "cannot open input\n");
+        return 2;
+    }
+
+    for (;;) {
+        ra = fscanf(fa, "%7s %u %lu %lu %lu %lf", qa, &calib_a, &idx_a, &adc_a, &aux_a, &va);
+        rb = fscanf(fb, "%7s %u %lu %lu %lu %lf", qb, &calib_b, &idx_b, &adc_b, &aux_b, &vb);
+        if (ra == EOF && rb == EOF) {
+            break;
+        }
+        line++;
+        if (ra != 6 || rb != 6 || strcmp(qa, qb) || calib_a != calib_b || idx_a != idx_b || adc_a != adc_b ||
+            aux_a != aux_b) {
+            fprintf(stderr, "vector sets differ at line %lu\n", line);
+            return 1;
+        }
+
+        struct err_stats *s = find(qa);
+        if (!s) {
+            fprintf(stderr, "unknown quantity '%s' at line %lu\n", qa, line);
+            return 1;
+        }
+
+        double err = fabs(vb - va);
+        double rel = (va != 0.0) ? err / fabs(va) : 0.0;
+
+        if (!(va > s->lo && va < s->hi)) {
+            s->n_out++;
+            if (err > s->max_abs_out) {
+                s->max_abs_out = err;
+            }
+            continue;
+        }
+
+        s->n++;
+        s->sum_abs += err;
+        if (rel > s->max_rel) {
+            s->max_rel = rel;
+        }
+        if (err > s->max_abs || s->n == 1) {
+            s->max_abs = err;
+            snprintf(s->max_at, sizeof(s->max_at), "calib %u adc %lu aux %lu", calib_a, adc_a, aux_a);
+        }
+    }
+
+    printf("%-3s %-5s %8s %14s %14s %12s  %-34s %8s %14s\n", "q", "unit", "vectors", "max abs", "mean abs",
+           "max rel", "worst vector", "out", "max abs out");
+    for (int i = 0; i < N_QUANTITIES; i++) {
+        struct err_stats *s = &stats[i];
+
+        if (!s->n && !s->n_out) {
+            continue;
+        }
+        printf("%-3s %-5s %8lu %14.6g %14.6g %12.3e  %-34s %8lu %14.6g\n", s->name, s->unit, s->n, s->max_abs,
+               s->n ? s->sum_abs / (double)s->n : 0.0, s->max_rel, s->max_at, s->n_out, s->max_abs_out);
+    }
+
+    return 0;
+}
@@ -0,0 +1,513 @@
+/*
+ * Checks the integer compensation against the formulas it replaced, bit for
+ * bit, and times both.
+ *
+ * The reference functions below are the driver's calc_temperature(),
+ * calc_pressure() and calc_humidity() as they were before the calibration-only
+ * terms moved to struct bme68x_comp_data. They are run next to the current
+ * ones on a typical calibration blob, the all-0x00/0x7F/0x80/0xFF extremes
+ * and pseudo-random blobs, all parsed through get_calib_data():
+ *   - T and t_fine over every 20-bit temperature ADC value
+ *   - P over the pressure ADC range in steps of PRES_STEP, at TEMP_POINTS
+ *     temperatures
+ *   - H over every 16-bit humidity ADC value at the same temperatures
+ * calc_gas_resistance_low() is checked against its 64 bit version with the
+ * gas range tables for every gas ADC value, gas range and range_sw_err
+ * (1024 x 16 x 16). comp_exact_test_div32 builds with BME68X_DIV_U64_U32,
+ * so the 32 bit long division the ESP32 runs is the one checked, and also
+ * checks div_u64_u32() on its own against the native division.
+ *
+ * Any mismatch fails the test. Then the cost of T+P+H and of the gas
+ * resistance per sample is measured for both, in TSC cycles on x86 and in ns
+ * elsewhere.
+ *
+ * Integer build only. The driver is compiled into this file to reach the
+ * internal calc_* functions.
+ *
+ * Usage: comp_exact_test[_div32] [n_random_blobs]
+ */
+#include "bme68x.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define N_RANDOM_DEFAULT    48u
+#define TEMP_POINTS         16u
+#define PRES_STEP           61u
+#define BENCH_N_INPUTS      256u
+#define BENCH_ROUNDS        20000u
+#define DIV_N_RANDOM        10000000u
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TICK_UNIT           "TSC cycles"
+#else
+#define TICK_UNIT           "ns"
+#endif
+
+/* Calibration blob 0 of bench/bme68x_bench.c, as read from COEFF1, COEFF2 and COEFF3 */
+static const uint8_t typical_calib[BME68X_LEN_COEFF_ALL] = {
+    0xe5, 0x66, 0x03, 0x00, 0x05, 0x8e, 0x54, 0xd7, 0x58, 0x00, 0x3e, 0x1a, 0x74, 0xff,
+    0x26, 0x1e, 0x00, 0x00, 0x11, 0xf2, 0x5c, 0xf4, 0x1e, 0x3f, 0x43, 0x31, 0x00, 0x2d,
+    0x14, 0x78, 0x9c, 0xcc, 0x65, 0x15, 0xcf, 0xe2, 0x12, 0x2c, 0x00, 0x10, 0x00, 0x20,
+};
+
+static const uint8_t fill_calib[4] = { 0x00, 0x7f, 0x80, 0xff };
+
+static uint8_t regs[256];
+static uint32_t lcg = 1;
+static volatile uint32_t sink;
+
+static BME68X_INTF_RET_TYPE mock_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)intf_ptr;
+    memcpy(reg_data, &regs[reg_addr], length);
+
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static BME68X_INTF_RET_TYPE mock_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)reg_addr;
+    (void)reg_data;
+    (void)length;
+    (void)intf_ptr;
+
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void mock_delay_us(uint32_t period, void *intf_ptr)
+{
+    (void)period;
+    (void)intf_ptr;
+}
+
+static uint8_t next_byte(void)
+{
+    lcg = lcg * 1103515245u + 12345u;
+    return (uint8_t)(lcg >> 16);
+}
+
+/* Parse a calibration blob through the driver, as bme68x_init() would */
+static int load_calib(const uint8_t *blob, struct bme68x_dev *dev)
+{
+    memcpy(&regs[BME68X_REG_COEFF1], blob, BME68X_LEN_COEFF1);
+    memcpy(&regs[BME68X_REG_COEFF2], &blob[BME68X_LEN_COEFF1], BME68X_LEN_COEFF2);
+    memcpy(&regs[BME68X_REG_COEFF3], &blob[BME68X_LEN_COEFF1 + BME68X_LEN_COEFF2], BME68X_LEN_COEFF3);
+
+    memset(dev, 0, sizeof(*dev));
+    dev->intf = BME68X_I2C_INTF;
+    dev->read = mock_read;
+    dev->write = mock_write;
+    dev->delay_us = mock_delay_us;
+    dev->amb_temp = 25;
+
+    return get_calib_data(dev) != BME68X_OK;
+}
+
+/* calc_temperature() before the precomputed terms, with 64 bit intermediates */
+static int16_t ref_temperature(uint32_t temp_adc, int32_t *t_fine, const struct bme68x_calib_data *calib)
+{
+    int64_t var1;
+    int64_t var2;
+    int64_t var3;
+
+    var1 = ((int32_t)temp_adc >> 3) - ((int32_t)calib->par_t1 << 1);
+    var2 = (var1 * (int32_t)calib->par_t2) >> 11;
+    var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
+    var3 = ((var3) * ((int32_t)calib->par_t3 << 4)) >> 14;
+    *t_fine = (int32_t)(var2 + var3);
+
+    return (int16_t)(((*t_fine * 5) + 128) >> 8);
+}
+
+/* var1 of calc_pressure() at the division, 0 only for a calibration no sensor has */
+static int32_t pres_divisor(int32_t t_fine, const struct bme68x_calib_data *calib)
+{
+    int32_t var1 = (t_fine >> 1) - 64000;
+
+    var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * ((int32_t)calib->par_p3 << 5)) >> 3) +
+           (((int32_t)calib->par_p2 * var1) >> 1);
+
+    return ((32768 + (var1 >> 18)) * (int32_t)calib->par_p1) >> 15;
+}
+
+/* calc_pressure() before the precomputed terms */
+static uint32_t ref_pressure(uint32_t pres_adc, int32_t t_fine, const struct bme68x_calib_data *calib)
+{
+    int32_t var1;
+    int32_t var2;
+    int32_t var3;
+    int32_t pressure_comp;
+    const int32_t pres_ovf_check = INT32_C(0x40000000);
+
+    var1 = (t_fine >> 1) - 64000;
+    var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t)calib->par_p6) >> 2;
+    var2 = var2 + ((var1 * (int32_t)calib->par_p5) << 1);
+    var2 = (var2 >> 2) + ((int32_t)calib->par_p4 << 16);
+    var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * ((int32_t)calib->par_p3 << 5)) >> 3) +
+           (((int32_t)calib->par_p2 * var1) >> 1);
+    var1 = var1 >> 18;
+    var1 = ((32768 + var1) * (int32_t)calib->par_p1) >> 15;
+    pressure_comp = 1048576 - pres_adc;
+    pressure_comp = (int32_t)((pressure_comp - (var2 >> 12)) * ((uint32_t)3125));
+    if (pressure_comp >= pres_ovf_check)
+    {
+        pressure_comp = ((pressure_comp / var1) << 1);
+    }
+    else
+    {
+        pressure_comp = ((pressure_comp << 1) / var1);
+    }
+
+    var1 = ((int32_t)calib->par_p9 * (int32_t)(((pressure_comp >> 3) * (pressure_comp >> 3)) >> 13)) >> 12;
+    var2 = ((int32_t)(pressure_comp >> 2) * (int32_t)calib->par_p8) >> 13;
+    var3 =
+        ((int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) *
+         (int32_t)calib->par_p10) >> 17;
+    pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 + ((int32_t)calib->par_p7 << 7)) >> 4);
+
+    return (uint32_t)pressure_comp;
+}
+
+/* calc_humidity() before the precomputed terms */
+static uint32_t ref_humidity(uint16_t hum_adc, int32_t t_fine, const struct bme68x_calib_data *calib)
+{
+    int32_t var1;
+    int32_t var2;
+    int32_t var3;
+    int32_t var4;
+    int32_t var5;
+    int32_t var6;
+    int32_t temp_scaled;
+    int32_t calc_hum;
+
+    temp_scaled = ((t_fine * 5) + 128) >> 8;
+    var1 = (int32_t)(hum_adc - ((int32_t)((int32_t)calib->par_h1 * 16))) -
+           (((temp_scaled * (int32_t)calib->par_h3) / ((int32_t)100)) >> 1);
+    var2 =
+        ((int32_t)calib->par_h2 *
+         (((temp_scaled * (int32_t)calib->par_h4) / ((int32_t)100)) +
+          (((temp_scaled * ((temp_scaled * (int32_t)calib->par_h5) / ((int32_t)100))) >> 6) / ((int32_t)100)) +
+          (int32_t)(1 << 14))) >> 10;
+    var3 = var1 * var2;
+    var4 = (int32_t)calib->par_h6 << 7;
+    var4 = ((var4) + ((temp_scaled * (int32_t)calib->par_h7) / ((int32_t)100))) >> 4;
+    var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
+    var6 = (var4 * var5) >> 1;
+    calc_hum = (((var3 + var6) >> 10) * ((int32_t)1000)) >> 12;
+    if (calc_hum > 100000)
+    {
+        calc_hum = 100000;
+    }
+    else if (calc_hum < 0)
+    {
+        calc_hum = 0;
+    }
+
+    return (uint32_t)calc_hum;
+}
+
+/* calc_gas_resistance_low() before the gas range tables, with a 64 bit divide */
+static uint32_t ref_gas_resistance_low(uint16_t gas_res_adc, uint8_t gas_range, const struct bme68x_calib_data *calib)
+{
+    int64_t var1;
+    uint64_t var2;
+    int64_t var3;
+    uint32_t lookup_table1[16] = {
+        UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
+        UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777), UINT32_C(2147483647), UINT32_C(2147483647),
+        UINT32_C(2143188679), UINT32_C(2136746228), UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647),
+        UINT32_C(2147483647)
+    };
+    uint32_t lookup_table2[16] = {
+        UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000), UINT32_C(512000000), UINT32_C(255744255),
+        UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064), UINT32_C(16016016), UINT32_C(8000000), UINT32_C(
+            4000000), UINT32_C(2000000), UINT32_C(1000000), UINT32_C(500000), UINT32_C(250000), UINT32_C(125000)
+    };
+
+    var1 = (int64_t)((1340 + (5 * (int64_t)calib->range_sw_err)) * ((int64_t)lookup_table1[gas_range])) >> 16;
+    var2 = (((int64_t)((int64_t)gas_res_adc << 15) - (int64_t)(16777216)) + var1);
+    var3 = (((int64_t)lookup_table2[gas_range] * (int64_t)var1) >> 9);
+
+    return (uint32_t)((var3 + ((int64_t)var2 >> 1)) / (int64_t)var2);
+}
+
+/* Every gas ADC value and gas range at every range_sw_err, returns the number of mismatches */
+static uint32_t check_gas(uint64_t *n_cmp)
+{
+    uint8_t blob[BME68X_LEN_COEFF_ALL];
+    struct bme68x_dev dev;
+    uint32_t n_bad = 0;
+    uint32_t adc;
+    uint8_t err, range;
+
+    memcpy(blob, typical_calib, sizeof(blob));
+    for (err = 0; err < 16; err++)
+    {
+        /* range_sw_err is the signed high nibble */
+        blob[BME68X_IDX_RANGE_SW_ERR] = (uint8_t)(err << 4);
+        if (load_calib(blob, &dev))
+        {
+            return 1;
+        }
+
+        for (range = 0; range < 16; range++)
+        {
+            for (adc = 0; adc < 1024; adc++)
+            {
+                n_bad += ref_gas_resistance_low((uint16_t)adc, range, &dev.calib) !=
+                         calc_gas_resistance_low((uint16_t)adc, range, &dev.calib);
+                (*n_cmp)++;
+            }
+        }
+    }
+
+    return n_bad;
+}
+
+#ifdef BME68X_DIV_U64_U32
+
+/* div_u64_u32() against the native division, on random operands with the high word below the divisor */
+static uint32_t check_div(uint64_t *n_cmp)
+{
+    uint64_t dividend;
+    uint32_t divisor, i, k;
+    uint32_t n_bad = 0;
+
+    for (i = 0; i < DIV_N_RANDOM; i++)
+    {
+        divisor = 0;
+        dividend = 0;
+        for (k = 0; k < 4; k++)
+        {
+            divisor = (divisor << 8) | next_byte();
+        }
+
+        for (k = 0; k < 8; k++)
+        {
+            dividend = (dividend << 8) | next_byte();
+        }
+
+        /* Narrow divisors too, they take every normalization shift */
+        divisor >>= i % 32;
+        if (divisor == 0)
+        {
+            divisor = 1;
+        }
+
+        dividend %= (uint64_t)divisor << 32;
+        n_bad += div_u64_u32(dividend, divisor) != (uint32_t)(dividend / divisor);
+        (*n_cmp)++;
+    }
+
+    return n_bad;
+}
+#endif
+
+/* Every comparison of one calibration, returns the number of mismatches */
+static uint32_t check_calib(const struct bme68x_calib_data *calib, uint64_t *n_cmp)
+{
+    uint32_t n_bad = 0;
+    uint32_t adc, k;
+    int32_t t_ref, t_new;
+    int16_t temp_ref, temp_new;
+
+    for (adc = 0; adc < (UINT32_C(1) << 20); adc++)
+    {
+        temp_ref = ref_temperature(adc, &t_ref, calib);
+        temp_new = calc_temperature(adc, &t_new, calib);
+        n_bad += (temp_ref != temp_new) || (t_ref != t_new);
+    }
+
+    *n_cmp += UINT32_C(1) << 20;
+
+    for (k = 0; k < TEMP_POINTS; k++)
+    {
+        /* 0x40000 up to 0xC0000 spans the sensor's temperature range and beyond */
+        (void)ref_temperature(UINT32_C(0x40000) + k * (UINT32_C(0x80000) / TEMP_POINTS), &t_ref, calib);
+
+        /* Both versions divide by zero there */
+        if (pres_divisor(t_ref, calib) != 0)
+        {
+            for (adc = 0; adc < (UINT32_C(1) << 20); adc += PRES_STEP)
+            {
+                n_bad += ref_pressure(adc, t_ref, calib) != calc_pressure(adc, t_ref, calib);
+                (*n_cmp)++;
+            }
+        }
+
+        for (adc = 0; adc <= UINT16_MAX; adc++)
+        {
+            n_bad += ref_humidity((uint16_t)adc, t_ref, calib) != calc_humidity((uint16_t)adc, t_ref, calib);
+        }
+
+        *n_cmp += UINT32_C(1) << 16;
+    }
+
+    return n_bad;
+}
+
+static uint64_t now_ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* T+P+H per sample, old formulas then current ones */
+static void bench_tph(const struct bme68x_calib_data *calib)
+{
+    static uint32_t temp_adc[BENCH_N_INPUTS], pres_adc[BENCH_N_INPUTS];
+    static uint16_t hum_adc[BENCH_N_INPUTS];
+    uint64_t t0, t_ref, t_new;
+    int32_t t_fine;
+    uint32_t r, i;
+
+    for (i = 0; i < BENCH_N_INPUTS; i++)
+    {
+        temp_adc[i] = 400000 + i * 800;
+        pres_adc[i] = 200000 + i * 1200;
+        hum_adc[i] = (uint16_t)(10000 + i * 120);
+    }
+
+    t0 = now_ticks();
+    for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (i = 0; i < BENCH_N_INPUTS; i++)
+        {
+            sink = (uint32_t)ref_temperature(temp_adc[i], &t_fine, calib);
+            sink = ref_pressure(pres_adc[i], t_fine, calib);
+            sink = ref_humidity(hum_adc[i], t_fine, calib);
+        }
+    }
+
+    t_ref = now_ticks() - t0;
+
+    t0 = now_ticks();
+    for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (i = 0; i < BENCH_N_INPUTS; i++)
+        {
+            sink = (uint32_t)calc_temperature(temp_adc[i], &t_fine, calib);
+            sink = calc_pressure(pres_adc[i], t_fine, calib);
+            sink = calc_humidity(hum_adc[i], t_fine, calib);
+        }
+    }
+
+    t_new = now_ticks() - t0;
+
+    printf("T+P+H: %.1f %s/sample before, %.1f after\n", (double)t_ref / (BENCH_ROUNDS * BENCH_N_INPUTS), TICK_UNIT,
+           (double)t_new / (BENCH_ROUNDS * BENCH_N_INPUTS));
+}
+
+/* Gas resistance per sample, 64 bit version then current one */
+static void bench_gas(const struct bme68x_calib_data *calib)
+{
+    static uint16_t gas_adc[BENCH_N_INPUTS];
+    static uint8_t gas_range[BENCH_N_INPUTS];
+    uint64_t t0, t_ref, t_new;
+    uint32_t r, i;
+
+    for (i = 0; i < BENCH_N_INPUTS; i++)
+    {
+        gas_adc[i] = (uint16_t)((i * 37) & 0x3ff);
+        gas_range[i] = (uint8_t)(i & 0x0f);
+    }
+
+    t0 = now_ticks();
+    for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (i = 0; i < BENCH_N_INPUTS; i++)
+        {
+            sink = ref_gas_resistance_low(gas_adc[i], gas_range[i], calib);
+        }
+    }
+
+    t_ref = now_ticks() - t0;
+
+    t0 = now_ticks();
+    for (r = 0; r < BENCH_ROUNDS; r++)
+    {
+        for (i = 0; i < BENCH_N_INPUTS; i++)
+        {
+            sink = calc_gas_resistance_low(gas_adc[i], gas_range[i], calib);
+        }
+    }
+
+    t_new = now_ticks() - t0;
+
+    printf("gas low: %.1f %s/sample before, %.1f after\n", (double)t_ref / (BENCH_ROUNDS * BENCH_N_INPUTS),
+           TICK_UNIT, (double)t_new / (BENCH_ROUNDS * BENCH_N_INPUTS));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n_random = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_RANDOM_DEFAULT;
+    uint8_t blob[BME68X_LEN_COEFF_ALL];
+    struct bme68x_dev dev;
+    uint64_t n_cmp = 0;
+    uint32_t n_bad = 0, n_calib = 0, n_gas_bad;
+#ifdef BME68X_DIV_U64_U32
+    uint32_t n_div_bad;
+#endif
+    uint32_t c, i;
+
+    for (c = 0; c < 1 + 4 + n_random; c++)
+    {
+        for (i = 0; i < BME68X_LEN_COEFF_ALL; i++)
+        {
+            if (c == 0)
+            {
+                blob[i] = typical_calib[i];
+            }
+            else if (c < 5)
+            {
+                blob[i] = fill_calib[c - 1];
+            }
+            else
+            {
+                blob[i] = next_byte();
+            }
+        }
+
+        if (load_calib(blob, &dev))
+        {
+            printf("calibration %u does not parse\n", c);
+            return 1;
+        }
+
+        n_bad += check_calib(&dev.calib, &n_cmp);
+        n_calib++;
+    }
+
+    printf("T/P/H: %u calibrations, %llu comparisons, %u mismatches\n", n_calib, (unsigned long long)n_cmp, n_bad);
+
+    n_cmp = 0;
+    n_gas_bad = check_gas(&n_cmp);
+#ifdef BME68X_DIV_U64_U32
+    printf("gas low, 32 bit division: %llu comparisons, %u mismatches\n", (unsigned long long)n_cmp, n_gas_bad);
+    n_cmp = 0;
+    n_gas_bad += n_div_bad = check_div(&n_cmp);
+    printf("div_u64_u32: %llu comparisons, %u mismatches\n", (unsigned long long)n_cmp, n_div_bad);
+#else
+    printf("gas low, native division: %llu comparisons, %u mismatches\n", (unsigned long long)n_cmp, n_gas_bad);
+#endif
+
+    (void)load_calib(typical_calib, &dev);
+    bench_tph(&dev.calib);
+    bench_gas(&dev.calib);
+
+    printf("%s\n", (n_bad || n_gas_bad) ? "FAIL" : "OK");
+
+    return (n_bad || n_gas_bad) ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * Checks the order bme68x_get_raw_data() returns the three field slots in,
+ * for parallel and sequential mode, against the pairwise sort the driver
+ * used before and against the order the slots were actually written in.
+ *
+ * Every newest sub-measurement index (0..255), slot the newest field sits
+ * in and number of new fields is tried. Fields without new data get every
+ * possible stale index, so they cannot steer the order.
+ *
+ * The test exits non-zero when a slot comes back out of place, or when the
+ * new order disagrees with the reference sort.
+ *
+ * Usage: field_order_test_{int,fpu}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bme68x.h"
+
+static uint8_t regs[256];
+
+static BME68X_INTF_RET_TYPE mock_read(uint8_t reg_addr, uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)intf_ptr;
+    memcpy(reg_data, &regs[(reg_addr & 0x7f)], length);
+
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static BME68X_INTF_RET_TYPE mock_write(uint8_t reg_addr, const uint8_t *reg_data, uint32_t length, void *intf_ptr)
+{
+    (void)reg_addr;
+    (void)reg_data;
+    (void)length;
+    (void)intf_ptr;
+
+    return BME68X_INTF_RET_SUCCESS;
+}
+
+static void mock_delay_us(uint32_t period, void *intf_ptr)
+{
+    (void)period;
+    (void)intf_ptr;
+}
+
+/* The pairwise sort bme68x_get_raw_data() used to run, kept as reference */
+static void ref_swap(uint8_t i, uint8_t j, uint8_t *slot)
+{
+    uint8_t tmp = slot[i];
+
+    slot[i] = slot[j];
+    slot[j] = tmp;
+}
+
+static void ref_sort(uint8_t *slot, const uint8_t *status, const uint8_t *idx)
+{
+    uint8_t i, j;
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = i + 1; j < 3; j++)
+        {
+            uint8_t lo = slot[i], hi = slot[j];
+
+            if ((status[lo] & BME68X_NEW_DATA_MSK) && (status[hi] & BME68X_NEW_DATA_MSK))
+            {
+                int16_t diff = (int16_t)idx[hi] - (int16_t)idx[lo];
+
+                if (((diff > -3) && (diff < 0)) || (diff > 2))
+                {
+                    ref_swap(i, j, slot);
+                }
+            }
+            else if (status[hi] & BME68X_NEW_DATA_MSK)
+            {
+                ref_swap(i, j, slot);
+            }
+        }
+    }
+}
+
+/* Fill slot s with a field the driver can tell apart by its pressure bytes */
+static void put_field(uint8_t s, uint8_t is_new, uint8_t meas_index)
+{
+    uint8_t *f = &regs[BME68X_REG_FIELD0 + s * BME68X_LEN_FIELD];
+
+    memset(f, 0, BME68X_LEN_FIELD);
+    f[0] = (uint8_t)((is_new ? BME68X_NEW_DATA_MSK : 0) | s);
+    f[1] = meas_index;
+    f[2] = (uint8_t)(0xa0 + s);
+}
+
+int main(void)
+{
+    struct bme68x_dev dev = { 0 };
+    struct bme68x_raw_data raw[3];
+    uint32_t n_cases = 0, n_fail = 0, n_ref_diff = 0;
+    uint16_t newest, stale;
+    uint8_t head, n_new;
+
+    dev.intf = BME68X_I2C_INTF;
+    dev.read = mock_read;
+    dev.write = mock_write;
+    dev.delay_us = mock_delay_us;
+    dev.variant_id = BME68X_VARIANT_GAS_LOW;
+
+    for (newest = 0; newest < 256; newest++)
+    {
+        for (head = 0; head < 3; head++)
+        {
+            for (n_new = 0; n_new <= 3; n_new++)
+            {
+                for (stale = 0; stale < (n_new < 3 ? 256 : 1); stale++)
+                {
+                    uint8_t expect[3], status[3], idx[3], ref[3] = { 0, 1, 2 };
+                    uint8_t k, n_data = 0xff;
+                    int8_t rslt;
+
+                    /* The newest field is in slot head, the ones before it in the slots before */
+                    for (k = 0; k < 3; k++)
+                    {
+                        uint8_t s = (uint8_t)((head + 3 - k) % 3);
+                        uint8_t is_new = k < n_new;
+
+                        idx[s] = is_new ? (uint8_t)(newest - k) : (uint8_t)stale;
+                        status[s] = is_new ? BME68X_NEW_DATA_MSK : 0;
+                        put_field(s, is_new, idx[s]);
+                        if (is_new)
+                        {
+                            expect[n_new - 1 - k] = s;
+                        }
+                    }
+
+                    rslt = bme68x_get_raw_data(BME68X_PARALLEL_MODE, raw, &n_data, &dev);
+                    n_cases++;
+                    if ((n_data != n_new) || (rslt != (n_new ? BME68X_OK : BME68X_W_NO_NEW_DATA)))
+                    {
+                        n_fail++;
+                        continue;
+                    }
+
+                    /* New fields oldest first, then every stale slot exactly once */
+                    for (k = 0; k < n_new; k++)
+                    {
+                        if ((raw[k].field[2] & 0x0f) != expect[k])
+                        {
+                            n_fail++;
+                            printf("newest %u head %u n_new %u stale %u: position %u holds slot %u, not %u\n",
+                                   newest, head, n_new, stale, k, raw[k].field[2] & 0x0f, expect[k]);
+                            break;
+                        }
+                    }
+
+                    if (((1u << (raw[0].field[2] & 0x0f)) | (1u << (raw[1].field[2] & 0x0f)) |
+                         (1u << (raw[2].field[2] & 0x0f))) != 0x07)
+                    {
+                        n_fail++;
+                    }
+
+                    /* The new order must keep the result of the old sort, a disagreement is a failure too */
+                    ref_sort(ref, status, idx);
+                    for (k = 0; k < n_new; k++)
+                    {
+                        if (ref[k] != expect[k])
+                        {
+                            n_ref_diff++;
+                            n_fail++;
+                            printf("newest %u head %u n_new %u stale %u: reference sort puts slot %u at position %u, not %u\n",
+                                   newest, head, n_new, stale, ref[k], k, expect[k]);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    printf("field order: %u cases, %u failures, reference sort disagrees with the write order in %u\n",
+           n_cases, n_fail, n_ref_diff);
+
+    return n_fail ? 1 : 0;
+}
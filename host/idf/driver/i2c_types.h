@@ -0,0 +1,8 @@
+#pragma once
+
+typedef int i2c_port_num_t;
+typedef struct i2c_master_bus_t *i2c_master_bus_handle_t;
+typedef struct i2c_master_dev_t *i2c_master_dev_handle_t;
+
+#define I2C_NUM_0   0
+#define I2C_NUM_1   1
@@ -0,0 +1,6 @@
+#pragma once
+
+typedef int spi_host_device_t;
+typedef struct spi_device_t *spi_device_handle_t;
+
+#define SPI3_HOST   2
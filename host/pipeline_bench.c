@@ -0,0 +1,153 @@
+/*
+ * Forced mode throughput with and without pipelining, on the simulator's
+ * virtual clock with the I2C bus time charged per byte.
+ *
+ * The serial loop triggers, waits, reads and compensates a frame, then
+ * processes it (logging, encoding, publishing, modelled as a fixed stage
+ * time) before the next trigger. The pipelined loop reads the frame raw,
+ * triggers the next conversion right away and compensates and processes the
+ * frame while the sensor converts. Both must give the same samples.
+ *
+ * Usage: pipeline_bench_{int,fpu} [n_samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bme68x.h"
+#include "bme680_sim.h"
+
+#define N_SAMPLES_DEFAULT   200u
+
+/* 9 clocks per byte at 400 kHz */
+#define I2C_US_PER_BYTE     23u
+
+static struct bme680_sim sim;
+static struct bme68x_dev dev;
+static uint32_t meas_us;
+
+static int setup(void)
+{
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X, .os_temp = BME68X_OS_4X, .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3, .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = { .enable = BME68X_ENABLE, .heatr_temp = 300, .heatr_dur = 100 };
+
+    bme680_sim_init(&sim, BME68X_VARIANT_GAS_LOW);
+    bme680_sim_attach(&sim, &dev);
+    sim.bus_us_per_byte = I2C_US_PER_BYTE;
+    dev.amb_temp = 25;
+    dev.shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL;
+    if (bme68x_init(&dev) || bme68x_set_conf(&conf, &dev) ||
+        bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev)) {
+        return 1;
+    }
+    meas_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &dev) + heatr_conf.heatr_dur * 1000u;
+
+    return 0;
+}
+
+/* Trigger, wait, read and compensate, then process: the stages add up */
+static double run_serial(uint32_t n, uint32_t stage_us, double *sum)
+{
+    struct bme68x_async meas = { 0 };
+    uint64_t t0 = sim.now_us;
+    uint32_t got = 0;
+    int8_t rslt;
+
+    *sum = 0;
+    while (got < n) {
+        rslt = bme68x_async_start(BME68X_FORCED_MODE, meas_us, &meas, &dev);
+        while (rslt == BME68X_W_ASYNC_BUSY) {
+            bme680_sim_advance(&sim, meas.wait_us);
+            rslt = bme68x_async_step(&meas, &dev);
+        }
+        if (rslt < BME68X_OK) {
+            return 0;
+        }
+        if (meas.n_data) {
+            *sum += meas.data[0].temperature;
+            got++;
+        }
+        bme680_sim_advance(&sim, stage_us);
+    }
+
+    return (double)n * 1e6 / (double)(sim.now_us - t0);
+}
+
+/* Read raw, trigger the next conversion, then compensate and process during it */
+static double run_pipelined(uint32_t n, uint32_t stage_us, double *sum)
+{
+    struct bme68x_async meas = { .raw = 1 };
+    struct bme68x_raw_data frame;
+    struct bme68x_data data;
+    uint64_t t0 = sim.now_us, t1, due;
+    uint32_t got = 0, wait;
+    int8_t rslt;
+
+    *sum = 0;
+    rslt = bme68x_async_start(BME68X_FORCED_MODE, meas_us, &meas, &dev);
+    wait = meas.wait_us;
+    while (got < n) {
+        bme680_sim_advance(&sim, wait);
+        rslt = bme68x_async_step(&meas, &dev);
+        if (rslt == BME68X_W_ASYNC_BUSY) {
+            wait = meas.wait_us;
+            continue;
+        }
+        if (rslt < BME68X_OK) {
+            return 0;
+        }
+
+        uint8_t have = meas.n_data;
+        frame = meas.raw_data[0];
+        if (bme68x_async_start(BME68X_FORCED_MODE, meas_us, &meas, &dev) != BME68X_W_ASYNC_BUSY) {
+            return 0;
+        }
+        due = sim.now_us + meas.wait_us;
+
+        if (have) {
+            (void)bme68x_compensate_raw(&frame, 1, &data, &dev.calib, dev.variant_id);
+            *sum += data.temperature;
+            got++;
+        }
+        bme680_sim_advance(&sim, stage_us);
+        wait = (due > sim.now_us) ? (uint32_t)(due - sim.now_us) : 0;
+    }
+    t1 = sim.now_us;
+
+    /* The conversion triggered after the last sample is not part of the run, let it finish */
+    bme680_sim_advance(&sim, wait);
+    (void)bme68x_async_step(&meas, &dev);
+
+    return (double)n * 1e6 / (double)(t1 - t0);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t stage_ms[] = { 0, 10, 50, 100, 200 };
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_SAMPLES_DEFAULT;
+    double serial, pipelined, sum_serial, sum_pipelined;
+    int rslt = 0;
+
+    if (setup()) {
+        printf("setup failed\n");
+        return 1;
+    }
+
+    printf("forced mode, %u samples, %u us conversion, %u us/byte on the bus\n", n, meas_us, I2C_US_PER_BYTE);
+    printf("  stage ms   serial/s  pipelined/s  conversion limit/s\n");
+    for (uint32_t i = 0; i < sizeof(stage_ms) / sizeof(stage_ms[0]); i++) {
+        serial = run_serial(n, stage_ms[i] * 1000u, &sum_serial);
+        pipelined = run_pipelined(n, stage_ms[i] * 1000u, &sum_pipelined);
+        printf("  %8u %10.2f %12.2f %19.2f\n", stage_ms[i], serial, pipelined, 1e6 / meas_us);
+        /* Without a stage both are conversion-bound, the pipeline only adds the trigger after the last sample */
+        if (serial == 0 || pipelined * 1.001 < serial || sum_serial != sum_pipelined) {
+            rslt = 1;
+        }
+    }
+
+    printf("%s\n", rslt ? "FAIL" : "OK");
+    return rslt;
+}
@@ -0,0 +1,280 @@
+/*
+ * Runs tasks/sensor_task.c on the host against simulated sensors, for a
+ * given span of virtual time, and reports what it published.
+ *
+ * The FreeRTOS and esp_timer calls of the task are implemented here on one
+ * virtual clock shared by all simulators: a sleep on the wake-up timer jumps
+ * the clock to the deadline plus SIM_WAKE_LATE_US, a tick delay jumps it by
+ * whole ticks. The registry holds the simulated sensors, at table positions
+ * 1 and up, and the full self-test is never due. The acquisition mode is the SENSOR_ACQ_MODE the target was
+ * built with.
+ *
+ * With bme680 the sensors are BME680s: parallel and sequential mode must
+ * refuse them and end the task, the other modes must run as usual. The
+ * program exits non-zero when the task does not behave that way or publishes
+ * nothing: samples, or fingerprints for the profile scan.
+ *
+ * Usage: sensor_task_sim_{forced,parallel,profile,pipelined} [seconds] [n_sensors] [bme680]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include "bme68x.h"
+#include "bme680_sim.h"
+#include "drv_bme680.h"
+#include "sample_bus.h"
+#include "sensor_task.h"
+
+#define SECONDS_DEFAULT     30u
+#define N_SENSORS_DEFAULT   2u
+#define MAX_SENSORS         4u
+
+/* How late the wake-up timer fires, a typical esp_timer task dispatch */
+#define SIM_WAKE_LATE_US    30u
+
+#define TICK_US             (1000000u / configTICK_RATE_HZ)
+
+static struct bme680_sim sims[MAX_SENSORS];
+static struct bme68x_dev devs[MAX_SENSORS];
+static uint8_t n_sensors = N_SENSORS_DEFAULT;
+static uint8_t variant = BME68X_VARIANT_GAS_HIGH;
+
+static uint64_t now_us;
+static uint64_t end_us;
+
+/* The only timer is the task's wake-up timer */
+static esp_timer_cb_t timer_cb;
+static void *timer_arg;
+static uint64_t timer_due_us;
+static bool timer_armed;
+static uint32_t n_notes;
+
+/* Parallel and sequential mode end the task on a BME680 */
+static bool refuses(void)
+{
+    return (variant == BME68X_VARIANT_GAS_LOW) &&
+           ((SENSOR_ACQ_MODE == SENSOR_ACQ_PARALLEL) || (SENSOR_ACQ_MODE == SENSOR_ACQ_PROFILE));
+}
+
+/* Every simulator to the latest clock, the driver's own waits only advance one of them */
+static void sync_clocks(void)
+{
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        if (sims[i].now_us > now_us) {
+            now_us = sims[i].now_us;
+        }
+    }
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        if (sims[i].now_us < now_us) {
+            bme680_sim_advance(&sims[i], now_us - sims[i].now_us);
+        }
+    }
+}
+
+static void finish(bool task_ended)
+{
+    double seconds = (double)now_us / 1e6;
+    uint32_t n_meas = 0;
+    int rslt;
+
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        n_meas += sims[i].n_meas;
+    }
+
+    printf("%.1f s, %u sensors: %.2f conversions/s, %u samples published (%.2f/s per sensor), %u fingerprints%s\n",
+           seconds, n_sensors, n_meas / seconds, sample_bus_published(&sensor_samples),
+           sample_bus_published(&sensor_samples) / seconds / n_sensors, sample_bus_published(&sensor_fingerprints),
+           task_ended ? ", task ended" : "");
+
+    if (refuses()) {
+        rslt = (task_ended && n_meas == 0) ? 0 : 1;
+    } else {
+        /* The profile scan only publishes fingerprints, the other modes only samples */
+        const sample_bus_t *bus = (SENSOR_ACQ_MODE == SENSOR_ACQ_PROFILE) ? &sensor_fingerprints : &sensor_samples;
+        rslt = (!task_ended && n_meas > 0 && sample_bus_published(bus) > 0) ? 0 : 1;
+    }
+
+    printf("%s\n", rslt ? "FAIL" : "OK");
+    exit(rslt);
+}
+
+static void advance(uint64_t us)
+{
+    sync_clocks();
+    now_us += us;
+    sync_clocks();
+    if (now_us >= end_us) {
+        finish(false);
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    sync_clocks();
+    return (int64_t)now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    timer_cb = args->callback;
+    timer_arg = args->arg;
+    *out = (esp_timer_handle_t)&timer_cb;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    (void)timer;
+    sync_clocks();
+    timer_due_us = now_us + timeout_us;
+    timer_armed = true;
+
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    timer_armed = false;
+
+    return ESP_OK;
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return (code == ESP_OK) ? "ESP_OK" : "ESP_FAIL";
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+    return taskSCHEDULER_RUNNING;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t)&n_notes;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    sync_clocks();
+    return (TickType_t)(now_us / TICK_US);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    advance((uint64_t)ticks * TICK_US);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    (void)task;
+    finish(true);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+    n_notes++;
+
+    return pdPASS;
+}
+
+/* Nothing else runs: a wait either has a notification, ends on the wake-up timer or times out */
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    uint32_t n;
+
+    (void)clear_on_exit;
+    if (n_notes == 0 && timer_armed) {
+        sync_clocks();
+        advance((timer_due_us > now_us) ? (timer_due_us - now_us + SIM_WAKE_LATE_US) : SIM_WAKE_LATE_US);
+        timer_armed = false;
+        timer_cb(timer_arg);
+    } else if (n_notes == 0 && wait != portMAX_DELAY) {
+        advance((uint64_t)wait * TICK_US);
+    }
+
+    n = n_notes;
+    n_notes = 0;
+
+    return n;
+}
+
+uint8_t bme680_registry_count(void)
+{
+    return n_sensors;
+}
+
+struct bme68x_dev *bme680_registry_get(uint8_t index)
+{
+    return (index < n_sensors) ? &devs[index] : NULL;
+}
+
+/* The first table entry is missing, so the ids differ from the registry indexes */
+uint8_t bme680_sensor_id(const struct bme68x_dev *handle)
+{
+    return (uint8_t)(handle - devs + 1);
+}
+
+bool bme68x_selftest_full_due(const struct bme68x_dev *handle)
+{
+    (void)handle;
+
+    return false;
+}
+
+int8_t bme68x_selftest_full(struct bme68x_dev *handle)
+{
+    (void)handle;
+
+    return BME68X_OK;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t seconds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : SECONDS_DEFAULT;
+
+    if (argc > 2) {
+        n_sensors = (uint8_t)strtoul(argv[2], NULL, 0);
+    }
+    if (n_sensors < 1 || n_sensors > MAX_SENSORS) {
+        printf("1 to %u sensors\n", MAX_SENSORS);
+        return 2;
+    }
+    if (argc > 3 && !strcmp(argv[3], "bme680")) {
+        variant = BME68X_VARIANT_GAS_LOW;
+    }
+
+    end_us = (uint64_t)seconds * 1000000u;
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        bme680_sim_init(&sims[i], variant);
+        bme680_sim_attach(&sims[i], &devs[i]);
+        sims[i].env.temp_adc += i * 5000u;
+        devs[i].amb_temp = 25;
+        devs[i].shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL;
+        if (bme68x_init(&devs[i]) != BME68X_OK) {
+            printf("bme68x_init failed\n");
+            return 1;
+        }
+    }
+
+    /* Time starts with the task, init and its waits are not part of the run */
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        sims[i].n_meas = 0;
+    }
+    sync_clocks();
+    end_us += now_us;
+
+    sensor_task(NULL);
+
+    /* The task only returns through vTaskDelete() */
+    return 1;
+}
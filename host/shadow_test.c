@@ -0,0 +1,203 @@
+/*
+ * Runs the same measurements on two simulated sensors, one read through the
+ * register shadow (BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL) and one without,
+ * and checks that both return the same struct bme68x_data while the shadow
+ * saves the bus transactions it is meant to save.
+ *
+ * Forced mode: a trigger, the wait and bme68x_get_data() per sample. Parallel
+ * mode: bme68x_get_data() per step. The transactions of each are counted and
+ * compared with the expected ones. bme68x_get_op_mode() must report forced
+ * mode while the conversion runs and sleep once its data was read. The test
+ * exits non-zero on any difference.
+ *
+ * Usage: shadow_test_{int,fpu} [n_samples]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bme68x.h"
+#include "bme680_sim.h"
+
+#define N_SAMPLES_DEFAULT   100u
+
+/* Transactions per sample: [0] without the shadow, [1] with it */
+static const uint32_t forced_get_rd[2] = { 4, 2 };     /* field burst, res_heat, idac, gas_wait / field burst, idac */
+static const uint32_t forced_trig_rd[2] = { 1, 0 };    /* CTRL_MEAS read back before the mode write */
+static const uint32_t forced_trig_wr[2] = { 1, 1 };
+static const uint32_t parallel_get_rd[2] = { 2, 2 };   /* field burst, 30 heater bytes / field burst, 10 idac bytes */
+
+static struct bme680_sim sim[2];
+static struct bme68x_dev dev[2];
+
+static void on_measure(struct bme680_sim *s, uint8_t gas_index, struct bme680_sim_env *env)
+{
+    (void)gas_index;
+    env->temp_adc += (s->n_meas % 16) * 64;
+    env->gas_adc = (uint16_t)(100 + (s->n_meas * 37) % 900);
+}
+
+static int same_data(const struct bme68x_data *a, const struct bme68x_data *b)
+{
+    return a->status == b->status && a->gas_index == b->gas_index && a->meas_index == b->meas_index &&
+           a->res_heat == b->res_heat && a->idac == b->idac && a->gas_wait == b->gas_wait &&
+           a->temperature == b->temperature && a->pressure == b->pressure && a->humidity == b->humidity &&
+           a->gas_resistance == b->gas_resistance;
+}
+
+/* Count and check the transactions of one phase, non-zero on a mismatch */
+static int check(const char *what, uint32_t n, uint32_t k, uint32_t rd, uint32_t wr, uint32_t exp_rd,
+                 uint32_t exp_wr)
+{
+    int bad = (rd != exp_rd * n) || (wr != exp_wr * n);
+
+    printf("  %-16s %-9s %.2f reads + %.2f writes per sample (expected %u + %u)%s\n", what,
+           k ? "shadow" : "no shadow", (double)rd / n, (double)wr / n, exp_rd, exp_wr, bad ? "  MISMATCH" : "");
+    return bad;
+}
+
+static int run_forced(uint32_t n)
+{
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X, .os_temp = BME68X_OS_4X, .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3, .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = { .enable = BME68X_ENABLE, .heatr_temp = 300, .heatr_dur = 100 };
+    struct bme68x_data data[2];
+    uint32_t trig_rd[2] = { 0 }, trig_wr[2] = { 0 }, get_rd[2] = { 0 }, get_wr[2] = { 0 }, rd, wr;
+    uint32_t diff = 0, mode_err = 0;
+    uint8_t n_data[2], mode;
+    int rslt = 0;
+
+    printf("forced mode\n");
+    for (uint32_t k = 0; k < 2; k++) {
+        if (bme68x_set_conf(&conf, &dev[k]) || bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev[k])) {
+            return 1;
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t k = 0; k < 2; k++) {
+            rd = sim[k].n_read;
+            wr = sim[k].n_write;
+            if (bme68x_set_op_mode(BME68X_FORCED_MODE, &dev[k])) {
+                return 1;
+            }
+            trig_rd[k] += sim[k].n_read - rd;
+            trig_wr[k] += sim[k].n_write - wr;
+
+            if (bme68x_get_op_mode(&mode, &dev[k]) || mode != BME68X_FORCED_MODE) {
+                mode_err++;
+            }
+
+            bme680_sim_advance(&sim[k], bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &dev[k]) +
+                               heatr_conf.heatr_dur * 1000u);
+
+            rd = sim[k].n_read;
+            wr = sim[k].n_write;
+            if (bme68x_get_data(BME68X_FORCED_MODE, &data[k], &n_data[k], &dev[k]) || n_data[k] != 1) {
+                return 1;
+            }
+            get_rd[k] += sim[k].n_read - rd;
+            get_wr[k] += sim[k].n_write - wr;
+
+            if (bme68x_get_op_mode(&mode, &dev[k]) || mode != BME68X_SLEEP_MODE) {
+                mode_err++;
+            }
+        }
+        if (!same_data(&data[0], &data[1])) {
+            diff++;
+        }
+    }
+
+    for (uint32_t k = 0; k < 2; k++) {
+        rslt |= check("trigger", n, k, trig_rd[k], trig_wr[k], forced_trig_rd[k], forced_trig_wr[k]);
+        rslt |= check("bme68x_get_data", n, k, get_rd[k], get_wr[k], forced_get_rd[k], 0);
+    }
+    printf("  %u samples, %u differ (idac 0x%02x), %u wrong modes\n", n, diff, data[1].idac, mode_err);
+
+    return rslt || diff || mode_err;
+}
+
+static int run_parallel(uint32_t n)
+{
+    static uint16_t temp_prof[] = { 200, 280, 320, 360 };
+    static uint16_t mul_prof[] = { 2, 3, 4, 5 };
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X, .os_temp = BME68X_OS_2X, .os_pres = BME68X_OS_1X,
+        .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE, .heatr_temp_prof = temp_prof, .heatr_dur_prof = mul_prof,
+        .profile_len = 4, .shared_heatr_dur = 100,
+    };
+    struct bme68x_data data[2][3];
+    uint32_t get_rd[2] = { 0 }, get_wr[2] = { 0 }, rd, wr, step_us;
+    uint32_t got = 0, diff = 0;
+    uint8_t n_data[2];
+    int rslt = 0;
+
+    printf("parallel mode\n");
+    for (uint32_t k = 0; k < 2; k++) {
+        if (bme68x_set_conf(&conf, &dev[k]) || bme68x_set_heatr_conf(BME68X_PARALLEL_MODE, &heatr_conf, &dev[k]) ||
+            bme68x_set_op_mode(BME68X_PARALLEL_MODE, &dev[k])) {
+            return 1;
+        }
+    }
+
+    step_us = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, &dev[0]) + heatr_conf.shared_heatr_dur * 1000u;
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t k = 0; k < 2; k++) {
+            bme680_sim_advance(&sim[k], step_us);
+            rd = sim[k].n_read;
+            wr = sim[k].n_write;
+            if (bme68x_get_data(BME68X_PARALLEL_MODE, data[k], &n_data[k], &dev[k]) < BME68X_OK) {
+                return 1;
+            }
+            get_rd[k] += sim[k].n_read - rd;
+            get_wr[k] += sim[k].n_write - wr;
+        }
+        if (n_data[0] != n_data[1]) {
+            diff++;
+            continue;
+        }
+        for (uint8_t j = 0; j < n_data[0]; j++) {
+            if (!same_data(&data[0][j], &data[1][j])) {
+                diff++;
+            }
+        }
+        got += n_data[0];
+    }
+
+    for (uint32_t k = 0; k < 2; k++) {
+        rslt |= check("bme68x_get_data", n, k, get_rd[k], get_wr[k], parallel_get_rd[k], 0);
+        rslt |= bme68x_set_op_mode(BME68X_SLEEP_MODE, &dev[k]) ? 1 : 0;
+    }
+    printf("  %u steps, %u fields, %u differ\n", n, got, diff);
+
+    return rslt || diff || !got;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_SAMPLES_DEFAULT;
+    int rslt = 0;
+
+    for (uint32_t k = 0; k < 2; k++) {
+        bme680_sim_init(&sim[k], BME68X_VARIANT_GAS_HIGH);
+        sim[k].on_measure = on_measure;
+        bme680_sim_attach(&sim[k], &dev[k]);
+        dev[k].amb_temp = 25;
+        dev[k].shadow_en = k ? (BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL) : 0;
+        if (bme68x_init(&dev[k]) != BME68X_OK) {
+            printf("bme68x_init failed\n");
+            return 1;
+        }
+    }
+
+    rslt |= run_forced(n);
+    rslt |= run_parallel(n);
+
+    printf("%s\n", rslt ? "FAIL" : "OK");
+    return rslt;
+}
@@ -0,0 +1,496 @@
+/*
+ * Runs the driver against the simulated sensor in forced, sequential and
+ * parallel mode, and in forced mode through the asynchronous API, and prints
+ * the samples with the bus traffic they cost. Also compares a cold
+ * bme68x_init() with a warm bme68x_init_cached(), and the quick self-test
+ * with the full one.
+ *
+ * Usage: sim_demo_{int,fpu} [n_samples] [bme688] [spi]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bme68x.h"
+#include "bme680_sim.h"
+
+#define N_SAMPLES_DEFAULT   6u
+
+static struct bme680_sim sim;
+static struct bme68x_dev dev;
+
+/* Slow drift in temperature and a gas resistance that falls as the heater step gets hotter */
+static void on_measure(struct bme680_sim *s, uint8_t gas_index, struct bme680_sim_env *env)
+{
+    int32_t gas_adc = 8 * (int32_t)s->regs[BME68X_REG_RES_HEAT0 + gas_index] - 300;
+
+    env->temp_adc += (s->n_meas % 16) * 64;
+    env->gas_adc = (uint16_t)(gas_adc < 50 ? 50 : (gas_adc > 1000 ? 1000 : gas_adc));
+}
+
+static void print_data(const struct bme68x_data *d)
+{
+#ifndef BME68X_USE_FPU
+    printf("  #%3u gas_index %u status 0x%02x  T %5d  P %6u  H %6u  G %8u\n",
+           d->meas_index, d->gas_index, d->status, d->temperature, (unsigned)d->pressure,
+           (unsigned)d->humidity, (unsigned)d->gas_resistance);
+#else
+    printf("  #%3u gas_index %u status 0x%02x  T %6.2f  P %9.2f  H %6.2f  G %10.2f\n",
+           d->meas_index, d->gas_index, d->status, d->temperature, d->pressure, d->humidity,
+           d->gas_resistance);
+#endif
+}
+
+static void print_cost(const char *mode, uint32_t n_samples, uint32_t n_rd, uint32_t n_wr, uint64_t t0_us)
+{
+    printf("  %s: %u samples, %.1f reads + %.1f writes per sample, %.1f ms virtual time\n",
+           mode, n_samples, (double)n_rd / n_samples, (double)n_wr / n_samples,
+           (double)(sim.now_us - t0_us) / 1000.0);
+}
+
+/* Quick self-test at boot against the full one */
+static int run_selftest(void)
+{
+    uint64_t t0;
+    int8_t rslt;
+    int8_t full;
+
+    printf("self-test\n");
+    t0 = sim.now_us;
+    rslt = bme68x_selftest_quick(&dev);
+    printf("  quick: %d, %.1f ms\n", rslt, (double)(sim.now_us - t0) / 1000.0);
+
+    /* The full test resets the sensor behind the shadow */
+    t0 = sim.now_us;
+    full = bme68x_selftest_check(&dev);
+    printf("  full: %d, %.1f ms\n", full, (double)(sim.now_us - t0) / 1000.0);
+
+    return (rslt == BME68X_OK && full == BME68X_OK && bme68x_sync_shadow(&dev) == BME68X_OK) ? 0 : 1;
+}
+
+/* Warm boot: initialize a second device from the calibration cache of the first */
+static int run_cached_init(void)
+{
+    struct bme68x_calib_cache cache;
+    struct bme68x_dev warm = { .amb_temp = 25, .shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL };
+    uint32_t rd, wr, delays;
+    uint64_t t0;
+    int8_t rslt;
+
+    printf("cached init\n");
+    if (bme68x_get_calib_cache(&cache, &dev)) {
+        return 1;
+    }
+    bme680_sim_attach(&sim, &warm);
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    delays = sim.n_delay;
+    t0 = sim.now_us;
+    if (bme68x_init(&warm)) {
+        return 1;
+    }
+    printf("  bme68x_init: %u reads, %u writes, %u waits, %.1f ms\n", sim.n_read - rd, sim.n_write - wr,
+           sim.n_delay - delays, (double)(sim.now_us - t0) / 1000.0);
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    delays = sim.n_delay;
+    t0 = sim.now_us;
+    memset(&warm.calib, 0, sizeof(warm.calib));
+    rslt = bme68x_init_cached(&cache, &warm);
+    printf("  bme68x_init_cached: %u reads, %u writes, %u waits, %.1f ms\n", sim.n_read - rd, sim.n_write - wr,
+           sim.n_delay - delays, (double)(sim.now_us - t0) / 1000.0);
+    if (rslt || memcmp(&warm.calib, &dev.calib, sizeof(dev.calib))) {
+        printf("  calibration differs from bme68x_init()\n");
+        return 1;
+    }
+
+    /* A corrupt cache and a swapped sensor must both fall back to bme68x_init() */
+    cache.calib.par_t1 ^= 1;
+    rslt = bme68x_init_cached(&cache, &warm);
+    cache.calib.par_t1 ^= 1;
+    sim.regs[BME68X_REG_COEFF2] ^= 1;
+    rslt = (rslt == BME68X_E_CALIB_CACHE) ? bme68x_init_cached(&cache, &warm) : BME68X_OK;
+    sim.regs[BME68X_REG_COEFF2] ^= 1;
+    if (rslt != BME68X_E_CALIB_CACHE) {
+        printf("  stale cache accepted\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+static int run_forced(uint32_t n)
+{
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X,
+        .os_temp = BME68X_OS_4X,
+        .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp = 300,
+        .heatr_dur = 100,
+    };
+    struct bme68x_data data;
+    uint32_t rd, wr, got = 0;
+    uint64_t t0;
+    uint8_t n_data;
+
+    printf("forced mode\n");
+    if (bme68x_set_conf(&conf, &dev) || bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev)) {
+        return 1;
+    }
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    t0 = sim.now_us;
+    for (uint32_t i = 0; i < n; i++) {
+        if (bme68x_set_op_mode(BME68X_FORCED_MODE, &dev)) {
+            return 1;
+        }
+        dev.delay_us(bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &dev) + heatr_conf.heatr_dur * 1000u,
+                     dev.intf_ptr);
+        if (bme68x_get_data(BME68X_FORCED_MODE, &data, &n_data, &dev) == BME68X_OK && n_data) {
+            print_data(&data);
+            got++;
+        }
+    }
+    print_cost("forced", got ? got : 1, sim.n_read - rd, sim.n_write - wr, t0);
+
+    return got == n ? 0 : 1;
+}
+
+/* Bus bytes of a forced sample on the interface in use, and their time on a 400 kHz I2C or 8 MHz SPI bus */
+static int run_bus(uint32_t n)
+{
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X,
+        .os_temp = BME68X_OS_4X,
+        .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp = 300,
+        .heatr_dur = 100,
+    };
+    struct bme68x_data data;
+    uint32_t rd, wr, bytes, got = 0;
+    uint8_t n_data;
+    double per_rd, per_wr, per_bytes, bus_us;
+
+    printf("bus cost, %s\n", dev.intf == BME68X_SPI_INTF ? "SPI" : "I2C");
+    if (bme68x_set_conf(&conf, &dev) || bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev)) {
+        return 1;
+    }
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    bytes = sim.n_read_bytes + sim.n_write_bytes;
+    for (uint32_t i = 0; i < n; i++) {
+        if (bme68x_set_op_mode(BME68X_FORCED_MODE, &dev)) {
+            return 1;
+        }
+        dev.delay_us(bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &dev) + heatr_conf.heatr_dur * 1000u,
+                     dev.intf_ptr);
+        if (bme68x_get_data(BME68X_FORCED_MODE, &data, &n_data, &dev) == BME68X_OK && n_data) {
+            got++;
+        }
+    }
+
+    per_rd = (double)(sim.n_read - rd) / (got ? got : 1);
+    per_wr = (double)(sim.n_write - wr) / (got ? got : 1);
+    per_bytes = (double)(sim.n_read_bytes + sim.n_write_bytes - bytes) / (got ? got : 1);
+    if (dev.intf == BME68X_SPI_INTF) {
+        /* 8 clocks per byte at 8 MHz */
+        bus_us = per_bytes;
+    } else {
+        /* 9 clocks per byte at 400 kHz, plus the device address, twice for a read */
+        bus_us = (per_bytes + per_wr + 2.0 * per_rd) * 9.0 / 0.4;
+    }
+    printf("  %.1f transactions, %.1f bytes, %.1f us on the bus per sample\n", per_rd + per_wr, per_bytes, bus_us);
+
+    return got == n ? 0 : 1;
+}
+
+/* Completion callback of the asynchronous run, counts the samples */
+static void on_async_done(int8_t rslt, const struct bme68x_data *data, uint8_t n_data, void *cb_arg)
+{
+    if (rslt == BME68X_OK && n_data) {
+        print_data(data);
+        (*(uint32_t *)cb_arg)++;
+    }
+}
+
+/* Forced mode through bme68x_async_*: the demo does the waiting, the driver must never call delay_us */
+static int run_async(uint32_t n)
+{
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X,
+        .os_temp = BME68X_OS_4X,
+        .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp = 300,
+        .heatr_dur = 100,
+    };
+    struct bme68x_async meas = { 0 };
+    uint32_t rd, wr, delays, steps = 0, got = 0;
+    uint64_t t0;
+    int8_t rslt;
+
+    printf("forced mode, asynchronous\n");
+    if (bme68x_set_conf(&conf, &dev) || bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &dev)) {
+        return 1;
+    }
+
+    meas.callback = on_async_done;
+    meas.cb_arg = &got;
+    rd = sim.n_read;
+    wr = sim.n_write;
+    delays = sim.n_delay;
+    t0 = sim.now_us;
+    for (uint32_t i = 0; i < n; i++) {
+        rslt = bme68x_async_start(BME68X_FORCED_MODE,
+                                  bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &dev) + heatr_conf.heatr_dur * 1000u,
+                                  &meas, &dev);
+        while (rslt == BME68X_W_ASYNC_BUSY) {
+            bme680_sim_advance(&sim, meas.wait_us);
+            rslt = bme68x_async_step(&meas, &dev);
+            steps++;
+        }
+    }
+    print_cost("async", got ? got : 1, sim.n_read - rd, sim.n_write - wr, t0);
+    printf("  async: %.1f steps per sample, %u delay_us calls in the driver\n",
+           (double)steps / (got ? got : 1), sim.n_delay - delays);
+
+    return (got == n && sim.n_delay == delays) ? 0 : 1;
+}
+
+/* Alternate two heater profiles, set from the configuration and from compiled images */
+static int run_switch(uint32_t n)
+{
+    static const char *const names[2] = { "low", "high" };
+    struct bme68x_heatr_conf heatr_conf[2] = {
+        { .enable = BME68X_ENABLE, .heatr_temp = 200, .heatr_dur = 50 },
+        { .enable = BME68X_ENABLE, .heatr_temp = 320, .heatr_dur = 150 },
+    };
+    struct bme68x_heatr_image image[2];
+    uint8_t regs[2][BME68X_REG_CTRL_GAS_1 - BME68X_REG_IDAC_HEAT0 + 1];
+    uint32_t rd, wr, conf_rd, conf_wr;
+    int rslt = 0;
+
+    printf("heater profile switch\n");
+    for (uint8_t i = 0; i < 2; i++) {
+        if (bme68x_compile_heatr_conf(BME68X_FORCED_MODE, &heatr_conf[i], &image[i], &dev)) {
+            return 1;
+        }
+    }
+
+    /* Reference: registers after bme68x_set_heatr_conf() */
+    rd = sim.n_read;
+    wr = sim.n_write;
+    for (uint32_t k = 0; k < 2 * n; k++) {
+        if (bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf[k % 2], &dev)) {
+            return 1;
+        }
+        memcpy(regs[k % 2], &sim.regs[BME68X_REG_IDAC_HEAT0], sizeof(regs[0]));
+    }
+    conf_rd = sim.n_read - rd;
+    conf_wr = sim.n_write - wr;
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    for (uint32_t k = 0; k < 2 * n; k++) {
+        if (bme68x_set_heatr_image(&image[k % 2], &dev)) {
+            return 1;
+        }
+        if (memcmp(regs[k % 2], &sim.regs[BME68X_REG_IDAC_HEAT0], sizeof(regs[0]))) {
+            printf("  profile %s: registers differ from bme68x_set_heatr_conf()\n", names[k % 2]);
+            rslt = 1;
+        }
+    }
+    printf("  %u switches: set_heatr_conf %.1f reads + %.1f writes, set_heatr_image %.1f reads + %.1f writes\n",
+           2 * n, (double)conf_rd / (2 * n), (double)conf_wr / (2 * n), (double)(sim.n_read - rd) / (2 * n),
+           (double)(sim.n_write - wr) / (2 * n));
+
+    return rslt;
+}
+
+/* Alternate two full configurations, set register by register and from compiled images */
+static int run_conf(uint32_t n)
+{
+    static const char *const names[2] = { "fast", "precise" };
+    struct bme68x_conf conf[2] = {
+        { .os_hum = BME68X_OS_1X, .os_temp = BME68X_OS_2X, .os_pres = BME68X_OS_1X,
+          .filter = BME68X_FILTER_OFF, .odr = BME68X_ODR_NONE },
+        { .os_hum = BME68X_OS_4X, .os_temp = BME68X_OS_8X, .os_pres = BME68X_OS_16X,
+          .filter = BME68X_FILTER_SIZE_3, .odr = BME68X_ODR_62_5_MS },
+    };
+    struct bme68x_heatr_conf heatr_conf[2] = {
+        { .enable = BME68X_ENABLE, .heatr_temp = 200, .heatr_dur = 50 },
+        { .enable = BME68X_ENABLE, .heatr_temp = 320, .heatr_dur = 150 },
+    };
+    struct bme68x_conf_image image[2];
+    uint8_t regs[2][BME68X_REG_CONFIG - BME68X_REG_IDAC_HEAT0 + 1];
+    uint32_t rd, wr, conf_rd, conf_wr;
+    int rslt = 0;
+
+    printf("configuration switch\n");
+    for (uint8_t i = 0; i < 2; i++) {
+        if (bme68x_compile_conf(BME68X_FORCED_MODE, &conf[i], &heatr_conf[i], &image[i], &dev)) {
+            return 1;
+        }
+    }
+
+    /* Reference: registers after bme68x_set_conf() and bme68x_set_heatr_conf() */
+    rd = sim.n_read;
+    wr = sim.n_write;
+    for (uint32_t k = 0; k < 2 * n; k++) {
+        if (bme68x_set_conf(&conf[k % 2], &dev) ||
+            bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf[k % 2], &dev)) {
+            return 1;
+        }
+        memcpy(regs[k % 2], &sim.regs[BME68X_REG_IDAC_HEAT0], sizeof(regs[0]));
+    }
+    conf_rd = sim.n_read - rd;
+    conf_wr = sim.n_write - wr;
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    for (uint32_t k = 0; k < 2 * n; k++) {
+        if (bme68x_set_conf_image(&image[k % 2], &dev)) {
+            return 1;
+        }
+        if (memcmp(regs[k % 2], &sim.regs[BME68X_REG_IDAC_HEAT0], sizeof(regs[0]))) {
+            printf("  configuration %s: registers differ from bme68x_set_conf()\n", names[k % 2]);
+            rslt = 1;
+        }
+    }
+    printf("  %u switches: set_conf + set_heatr_conf %.1f reads + %.1f writes, set_conf_image %.1f reads + %.1f writes\n",
+           2 * n, (double)conf_rd / (2 * n), (double)conf_wr / (2 * n), (double)(sim.n_read - rd) / (2 * n),
+           (double)(sim.n_write - wr) / (2 * n));
+
+    return rslt;
+}
+
+static int run_profile(uint8_t op_mode, uint32_t n)
+{
+    uint16_t temp_prof[3] = { 200, 300, 400 };
+    uint16_t dur_prof[3] = { 5, 5, 5 };
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X,
+        .os_temp = BME68X_OS_2X,
+        .os_pres = BME68X_OS_1X,
+        .filter = BME68X_FILTER_OFF,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp_prof = temp_prof,
+        .heatr_dur_prof = dur_prof,
+        .profile_len = 3,
+    };
+    struct bme68x_data data[3];
+    const char *name = (op_mode == BME68X_PARALLEL_MODE) ? "parallel" : "sequential";
+    uint32_t rd, wr, wait_us, got = 0;
+    uint64_t t0;
+    uint8_t n_data, last = 0, seen = 0;
+
+    if (op_mode == BME68X_PARALLEL_MODE) {
+        /* Multiples of the shared duration in parallel mode */
+        dur_prof[0] = dur_prof[1] = dur_prof[2] = 2;
+        heatr_conf.shared_heatr_dur = (uint16_t)(140 - bme68x_get_meas_dur(op_mode, &conf, &dev) / 1000);
+    }
+
+    printf("%s mode\n", name);
+    if (bme68x_set_conf(&conf, &dev) || bme68x_set_heatr_conf(op_mode, &heatr_conf, &dev)) {
+        return 1;
+    }
+
+    /* One result per wait: TPH plus the heater phase of a step */
+    wait_us = bme68x_get_meas_dur(op_mode, &conf, &dev);
+    wait_us += (op_mode == BME68X_PARALLEL_MODE) ? heatr_conf.shared_heatr_dur * 1000u : dur_prof[0] * 1000u;
+
+    rd = sim.n_read;
+    wr = sim.n_write;
+    t0 = sim.now_us;
+    if (bme68x_set_op_mode(op_mode, &dev)) {
+        return 1;
+    }
+    while (got < n) {
+        dev.delay_us(wait_us, dev.intf_ptr);
+        if (bme68x_get_data(op_mode, data, &n_data, &dev) != BME68X_OK) {
+            continue;
+        }
+        /* new_data stays set until a slot is reused, skip fields already seen */
+        for (uint8_t i = 0; i < n_data && got < n; i++) {
+            uint8_t step = (uint8_t)(data[i].meas_index - last);
+
+            if (!seen || (step > 0 && step < 128)) {
+                print_data(&data[i]);
+                last = data[i].meas_index;
+                seen = 1;
+                got++;
+            }
+        }
+    }
+    print_cost(name, got, sim.n_read - rd, sim.n_write - wr, t0);
+
+    return bme68x_set_op_mode(BME68X_SLEEP_MODE, &dev) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : N_SAMPLES_DEFAULT;
+    uint8_t variant = BME68X_VARIANT_GAS_LOW;
+    uint8_t spi = 0;
+    int rslt = 0;
+
+    for (int i = 2; i < argc; i++) {
+        if (!strcmp(argv[i], "bme688")) {
+            variant = BME68X_VARIANT_GAS_HIGH;
+        } else if (!strcmp(argv[i], "spi")) {
+            spi = 1;
+        }
+    }
+
+    bme680_sim_init(&sim, variant);
+    sim.spi = spi;
+    sim.on_measure = on_measure;
+    bme680_sim_attach(&sim, &dev);
+    dev.amb_temp = 25;
+    dev.shadow_en = BME68X_SHADOW_HEATR | BME68X_SHADOW_CTRL;
+
+    if (bme68x_init(&dev) != BME68X_OK) {
+        fprintf(stderr, "bme68x_init failed\n");
+        return 1;
+    }
+    printf("chip 0x%02x variant %u, init: %u reads, %u writes\n", dev.chip_id, (unsigned)dev.variant_id,
+           sim.n_read, sim.n_write);
+
+    rslt |= run_cached_init();
+    rslt |= run_forced(n);
+    rslt |= run_bus(n);
+    rslt |= run_async(n);
+    rslt |= run_switch(n);
+    rslt |= run_conf(n);
+    if (variant == BME68X_VARIANT_GAS_HIGH) {
+        rslt |= run_profile(BME68X_SEQUENTIAL_MODE, n);
+        rslt |= run_profile(BME68X_PARALLEL_MODE, n);
+    } else {
+        printf("sequential and parallel mode need a BME688 (run with 'bme688')\n");
+    }
+    rslt |= run_selftest();
+
+    return rslt;
+}
@@ -5,26 +5,35 @@
 #include "freertos/FreeRTOS.h"
 #include "esp_log.h"
 #include "driver/i2c.h"
+#include "nvs_flash.h"
 
 #include "bme68x.h"
 #include "bme68x_defs.h"
 #include "drv_bme680.h"
+#include "logger_task.h"
 #include "sensor_task.h"
 
 #define DEBUG 1
 
 /* Global variables ------------------------------------------------------------------------------------------- */
-struct bme68x_dev bme = {0};
-static struct bme68x_i2c_ctx i2c_ctx = {0};
-static i2c_master_bus_handle_t i2cMasterBus = NULL;
-const uint8_t bme_addr = BME680_I2C_ADDR_1;
+/* Sensors to look for, the ones that do not answer are skipped. The position is the sensor's cache id */
+static const bme680_sensor_cfg_t sensor_table[] = {
+    { .intf = BME68X_I2C_INTF, .port = I2C_PORT_NUM, .sda_gpio = I2C_SDA_GPIO, .scl_gpio = I2C_SCL_GPIO,
+      .addr = BME680_I2C_ADDR_1 },
+    { .intf = BME68X_I2C_INTF, .port = I2C_PORT_NUM, .sda_gpio = I2C_SDA_GPIO, .scl_gpio = I2C_SCL_GPIO,
+      .addr = BME680_I2C_ADDR_0 },
+    { .intf = BME68X_I2C_INTF, .port = I2C1_PORT_NUM, .sda_gpio = I2C1_SDA_GPIO, .scl_gpio = I2C1_SCL_GPIO,
+      .addr = BME680_I2C_ADDR_1 },
+    { .intf = BME68X_I2C_INTF, .port = I2C1_PORT_NUM, .sda_gpio = I2C1_SDA_GPIO, .scl_gpio = I2C1_SCL_GPIO,
+      .addr = BME680_I2C_ADDR_0 },
+#if BME680_USE_SPI
+    { .intf = BME68X_SPI_INTF, .spi_host = SPI_HOST_NUM, .mosi_gpio = SPI_MOSI_GPIO, .miso_gpio = SPI_MISO_GPIO,
+      .sclk_gpio = SPI_SCLK_GPIO, .cs_gpio = SPI_CS_GPIO },
+#endif
+};
 
 static const char TAG[] = "APP MAIN";
 
-/* Queues */
-static const uint8_t QueueLength = 8;
-QueueHandle_t MainQueue = NULL;
-
 /* Static functions ------------------------------------------------------------------------------------------- */
 static void log_hex(const char *label, const uint8_t *data, size_t len) {
     char line[3 * 32 + 1]; // up to 32 bytes per line
@@ -51,31 +60,42 @@ void app_main(void) {
     ESP_LOGW("BOOT", "Reset reason: %d", esp_reset_reason());
 #endif
 
-    esp_err_t err = bm68x_i2c_init_itf(&bme, &i2c_ctx);
+    /* NVS holds the sensor calibration cache */
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "I2C Bus initialization failed\n");
-        return;
+        ESP_LOGW(TAG, "NVS init failed, calibration is not cached: %s", esp_err_to_name(err));
     }
 
-    int8_t rslt = bme68x_init(&bme);
-    if (rslt != BME68X_OK) {
-        ESP_LOGE(TAG, "BME68X initialization failed\n");
+    uint8_t n_sensors = bme680_registry_init(sensor_table, sizeof(sensor_table) / sizeof(sensor_table[0]));
+    if (n_sensors == 0) {
+        ESP_LOGE(TAG, "BME68X initialization failed, no sensor found\n");
         return;
     }
-    ESP_LOGI(TAG, "BME68X initialization successful\n");
-
-    rslt = bme68x_selftest_check(&bme);
-    if (rslt != BME68X_OK) {
-        ESP_LOGE(TAG, "Self-test failed\n");
+    ESP_LOGI(TAG, "BME68X initialization successful, %u sensors\n", n_sensors);
+
+    /* Quick check only, the sensor task runs the full self-test when it is due */
+    for (uint8_t i = 0; i < n_sensors; i++) {
+        struct bme68x_dev *dev = bme680_registry_get(i);
+        int8_t rslt = bme68x_selftest_boot(dev);
+        if (rslt != BME68X_OK) {
+            ESP_LOGE(TAG, "Sensor %u quick self-test failed: %d\n", bme680_sensor_id(dev), rslt);
+        } else {
+            ESP_LOGI(TAG, "Sensor %u quick self-test OK", bme680_sensor_id(dev));
+        }
     }
-    ESP_LOGI(TAG, "Self-test OK");
 
-    /* Create the main queue */
-    MainQueue = xQueueCreate(QueueLength, sizeof(sensor_data_t));
-    if (MainQueue == NULL) {
-        ESP_LOGE(TAG, "Failed to create MainQueue");
-        return;
-    }
+    /* Consumers of the sensor buses first, so they get the first samples. They preempt app_main to subscribe */
+    xTaskCreate
+        (logger_task,   // Task function
+        "logger_task",  // Task name
+        3072,           // Stack size
+        NULL,           // Task parameters
+        4,              // Task priority
+        NULL);          // Task handle
 
     /* Create sensor task */
     xTaskCreate
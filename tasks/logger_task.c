@@ -0,0 +1,72 @@
+//
+// Logs the samples and fingerprints of the sensor task's buses.
+//
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "logger_task.h"
+#include "sample_bus.h"
+#include "sensor_task.h"
+
+static const char TAG[] = "LOGGER_TASK";
+
+static void log_sample(const sensor_data_t *sample) {
+    ESP_LOGI(TAG, "Sensor %u Temperature: %.2f, Pressure: %.2f, Humidity: %.2f, Gas Resistance: %.2f, woke %ld us late",
+             sample->sensor_id, sample->temperature, sample->pressure, sample->humidity, sample->gas_resistance,
+             (long)sample->wake_late_us);
+}
+
+static void log_fingerprint(const sensor_fingerprint_t *fp) {
+    ESP_LOGI(TAG, "Sensor %u cycle %lu steps 0x%03x stable 0x%03x, T %.2f H %.2f P %.2f",
+             fp->sensor_id, (unsigned long)fp->cycle, fp->got_mask, fp->stable_mask, fp->steps[0].temperature,
+             fp->steps[0].humidity, fp->steps[0].pressure);
+    for (uint8_t i = 0; i < SENSOR_PROFILE_LEN; i++) {
+        ESP_LOGD(TAG, "  %u degC: %.0f Ohm", fp->heatr_temp[i], fp->steps[i].gas_resistance);
+    }
+}
+
+/* Log what sub lost since the last call */
+static void log_dropped(const sample_bus_sub_t *sub, uint32_t *dropped) {
+    if (sub->n_dropped != *dropped) {
+        ESP_LOGW(TAG, "%lu %s dropped, %lu in total", (unsigned long)(sub->n_dropped - *dropped), sub->name,
+                 (unsigned long)sub->n_dropped);
+        *dropped = sub->n_dropped;
+    }
+}
+
+void logger_task(void *arg) {
+    (void)arg;
+
+    /* A slow log loses old items rather than holding up the sensor task */
+    sample_bus_sub_t *samples = sample_bus_subscribe(&sensor_samples, "samples", SAMPLE_BUS_DROP_OLDEST);
+    sample_bus_sub_t *fingerprints = sample_bus_subscribe(&sensor_fingerprints, "fingerprints",
+                                                          SAMPLE_BUS_DROP_OLDEST);
+    if (samples == NULL || fingerprints == NULL) {
+        ESP_LOGE(TAG, "No free subscription on the sensor buses");
+        vTaskDelete(NULL);
+        return;
+    }
+
+    uint32_t samples_dropped = 0;
+    uint32_t fingerprints_dropped = 0;
+    while (1) {
+        /* Both buses notify this task, so it only sleeps once neither has anything left */
+        const sensor_data_t *sample = sample_bus_read(samples, 0);
+        const sensor_fingerprint_t *fp = sample_bus_read(fingerprints, 0);
+        if (sample == NULL && fp == NULL) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        if (sample != NULL) {
+            log_sample(sample);
+            log_dropped(samples, &samples_dropped);
+        }
+        if (fp != NULL) {
+            log_fingerprint(fp);
+            log_dropped(fingerprints, &fingerprints_dropped);
+        }
+    }
+}
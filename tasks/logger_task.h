@@ -0,0 +1,11 @@
+//
+// Logs the samples and fingerprints of the sensor task's buses.
+//
+
+#ifndef LAERA_FW_LOGGER_TASK_H
+#define LAERA_FW_LOGGER_TASK_H
+
+/* Subscribes to the sample and fingerprint buses and logs every item, start it before the sensor task */
+void logger_task(void *arg);
+
+#endif //LAERA_FW_LOGGER_TASK_H
@@ -0,0 +1,130 @@
+//
+// Sample buses between the sensor task and its consumers.
+//
+// Every item is written once into a pool slot and read in place by all
+// subscribers. The newest depth slots are kept in a ring ordered by
+// sequence number, each subscriber has its own cursor into it. A slot
+// goes back to the pool once it left the ring and no subscriber holds it,
+// so the pool never runs out: ring, one held slot per subscriber and the
+// one the producer is filling.
+//
+
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sample_bus.h"
+
+
+void *sample_bus_claim(sample_bus_t *bus) {
+    void *item = NULL;
+
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < bus->pool_size; i++) {
+        if (bus->refs[i] == 0) {
+            bus->refs[i] = 1;
+            item = bus->items + i * bus->item_size;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&bus->lock);
+
+    return item;
+}
+
+void sample_bus_publish(sample_bus_t *bus, void *item) {
+    uint8_t slot = (uint8_t)(((uint8_t *)item - bus->items) / bus->item_size);
+    uint8_t pos = (uint8_t)(bus->head & (bus->depth - 1U));
+    uint8_t n;
+
+    /* The producer's reference becomes the ring's, the item it replaces loses its own */
+    portENTER_CRITICAL(&bus->lock);
+    if (bus->n_ring == bus->depth) {
+        bus->refs[bus->ring[pos]]--;
+    } else {
+        bus->n_ring++;
+    }
+    bus->ring[pos] = slot;
+    bus->head++;
+    n = bus->n_subs;
+    portEXIT_CRITICAL(&bus->lock);
+
+    for (uint8_t i = 0; i < n; i++) {
+        xTaskNotifyGive(bus->subs[i].task);
+    }
+}
+
+sample_bus_sub_t *sample_bus_subscribe(sample_bus_t *bus, const char *name, sample_bus_policy_t policy) {
+    sample_bus_sub_t *sub = NULL;
+
+    portENTER_CRITICAL(&bus->lock);
+    if (bus->n_subs < SAMPLE_BUS_MAX_SUBS) {
+        sub = &bus->subs[bus->n_subs];
+        sub->name = name;
+        sub->bus = bus;
+        sub->policy = policy;
+        sub->task = xTaskGetCurrentTaskHandle();
+        sub->cursor = bus->head;
+        sub->held = -1;
+        sub->n_read = 0;
+        sub->n_dropped = 0;
+        bus->n_subs++;
+    }
+    portEXIT_CRITICAL(&bus->lock);
+
+    return sub;
+}
+
+void sample_bus_release(sample_bus_sub_t *sub) {
+    sample_bus_t *bus = sub->bus;
+
+    if (sub->held < 0) {
+        return;
+    }
+
+    portENTER_CRITICAL(&bus->lock);
+    bus->refs[sub->held]--;
+    portEXIT_CRITICAL(&bus->lock);
+    sub->held = -1;
+}
+
+const void *sample_bus_read(sample_bus_sub_t *sub, TickType_t wait) {
+    sample_bus_t *bus = sub->bus;
+    TickType_t start = xTaskGetTickCount();
+
+    sample_bus_release(sub);
+
+    while (1) {
+        portENTER_CRITICAL(&bus->lock);
+        uint32_t behind = bus->head - sub->cursor;
+        if (behind > 0) {
+            /* Skip what the policy gives up, the ring only goes back depth items */
+            uint32_t keep = (sub->policy == SAMPLE_BUS_LATEST_ONLY) ? 1 : bus->depth;
+            if (behind > keep) {
+                sub->n_dropped += behind - keep;
+                sub->cursor = bus->head - keep;
+            }
+
+            uint8_t slot = bus->ring[sub->cursor & (bus->depth - 1U)];
+            bus->refs[slot]++;
+            portEXIT_CRITICAL(&bus->lock);
+
+            sub->held = (int8_t)slot;
+            sub->cursor++;
+            sub->n_read++;
+            return bus->items + slot * bus->item_size;
+        }
+        portEXIT_CRITICAL(&bus->lock);
+
+        /* A notification for an item already read only costs a loop */
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait || ulTaskNotifyTake(pdTRUE, wait - elapsed) == 0) {
+            return NULL;
+        }
+    }
+}
+
+uint32_t sample_bus_published(const sample_bus_t *bus) {
+    return bus->head;
+}
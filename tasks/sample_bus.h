@@ -0,0 +1,113 @@
+//
+// Sample buses between the sensor task and its consumers.
+//
+
+#ifndef LAERA_FW_SAMPLE_BUS_H
+#define LAERA_FW_SAMPLE_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "macros.h"
+
+/* ----------------------------- Configuration ---------------------------------- */
+
+/* Samples a subscriber can fall behind before it loses some, a power of two */
+#ifndef SAMPLE_BUS_DEPTH
+#define SAMPLE_BUS_DEPTH        16
+#endif
+
+/* Fingerprints a subscriber can fall behind, one comes per heater profile cycle. A power of two */
+#ifndef FINGERPRINT_BUS_DEPTH
+#define FINGERPRINT_BUS_DEPTH   2
+#endif
+
+/* Subscribers a bus can hold */
+#ifndef SAMPLE_BUS_MAX_SUBS
+#define SAMPLE_BUS_MAX_SUBS     4
+#endif
+
+/* Pool of a bus keeping depth items: the ring, one held item per subscriber and the one the producer fills */
+#define SAMPLE_BUS_POOL_SIZE(depth)     ((depth) + SAMPLE_BUS_MAX_SUBS + 1)
+
+/* ----------------------------- Data structures ---------------------------------- */
+
+/* What a subscriber loses when it falls behind, the producer never waits */
+typedef enum {
+    SAMPLE_BUS_DROP_OLDEST,     /* the items older than the last depth of the bus */
+    SAMPLE_BUS_LATEST_ONLY,     /* every item but the newest */
+} sample_bus_policy_t;
+
+typedef struct sample_bus sample_bus_t;
+
+/* A consumer of a bus, read from its own task only */
+typedef struct {
+    const char *name;
+    sample_bus_t *bus;
+    sample_bus_policy_t policy;
+    TaskHandle_t task;          /* woken by a notification on publish */
+    uint32_t cursor;            /* sequence number of the next item to read */
+    int8_t held;                /* pool slot of the last read, -1 for none */
+    uint32_t n_read;
+    uint32_t n_dropped;         /* items skipped by the policy */
+} sample_bus_sub_t;
+
+/* A bus of fixed size items, define one with SAMPLE_BUS_DEFINE() */
+struct sample_bus {
+    uint8_t *items;             /* pool, item_size bytes per slot */
+    uint8_t *refs;              /* per pool slot: ring, subscribers holding it and the producer filling it */
+    uint8_t *ring;              /* pool slot of sequence number n at n & (depth - 1) */
+    size_t item_size;
+    uint8_t depth;
+    uint8_t pool_size;
+    uint32_t head;              /* sequence number of the next item, wraps */
+    uint8_t n_ring;             /* items in the ring, once it holds depth each publish replaces the oldest */
+    sample_bus_sub_t subs[SAMPLE_BUS_MAX_SUBS];
+    uint8_t n_subs;
+    portMUX_TYPE lock;          /* held by the producer and subscribers on both cores, only for a few index updates */
+};
+
+/* Define the bus name and its static storage, for items of type and depth of them kept for the subscribers.
+ * depth is a power of two, so the ring position stays in step when the sequence numbers wrap */
+#define SAMPLE_BUS_DEFINE(name, type, depth_)                                                           \
+    STATIC_ASSERT(SAMPLE_BUS_POOL_SIZE(depth_) <= INT8_MAX, "sample_bus_sub_t.held is an int8_t");      \
+    STATIC_ASSERT(((depth_) & ((depth_) - 1)) == 0, "the ring position wraps with the sequence number");  \
+    static type name##_items[SAMPLE_BUS_POOL_SIZE(depth_)];                                             \
+    static uint8_t name##_refs[SAMPLE_BUS_POOL_SIZE(depth_)];                                           \
+    static uint8_t name##_ring[depth_];                                                                 \
+    sample_bus_t name = {                                                                               \
+        .items = (uint8_t *)name##_items,                                                               \
+        .refs = name##_refs,                                                                            \
+        .ring = name##_ring,                                                                            \
+        .item_size = sizeof(type),                                                                      \
+        .depth = (depth_),                                                                              \
+        .pool_size = SAMPLE_BUS_POOL_SIZE(depth_),                                                      \
+        .lock = portMUX_INITIALIZER_UNLOCKED,                                                           \
+    }
+
+/* ----------------------------- Function prototypes ---------------------------------- */
+
+/* Producer: a free slot to write the next item into, NULL only when the bus is misused */
+void *sample_bus_claim(sample_bus_t *bus);
+
+/* Producer: hand a claimed slot to every subscriber, the bus keeps it until all moved past it */
+void sample_bus_publish(sample_bus_t *bus, void *item);
+
+/* Subscribe the calling task from the next published item on, NULL when SAMPLE_BUS_MAX_SUBS are taken */
+sample_bus_sub_t *sample_bus_subscribe(sample_bus_t *bus, const char *name, sample_bus_policy_t policy);
+
+/* Next item of sub, waiting up to wait ticks for one. It is read in place and stays valid until the next
+ * read or sample_bus_release(). NULL on timeout. Every bus notifies its subscribers the same way, so a task
+ * on several buses reads each with no wait and sleeps on ulTaskNotifyTake() when all are empty */
+const void *sample_bus_read(sample_bus_sub_t *sub, TickType_t wait);
+
+/* Let go of the item of the last read */
+void sample_bus_release(sample_bus_sub_t *sub);
+
+/* Items published on bus since boot */
+uint32_t sample_bus_published(const sample_bus_t *bus);
+
+#endif //LAERA_FW_SAMPLE_BUS_H
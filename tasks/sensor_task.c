@@ -6,16 +6,343 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 
+#include <sys/time.h>
+
 #include "bme68x.h"
 #include "bme68x_defs.h"
+#include "drv_bme680.h"
+#include "sample_bus.h"
 #include "sensor_task.h"
 #include "esp_log.h"
-
-extern struct bme68x_dev bme;
+#include "esp_timer.h"
+#include "macros.h"
 
 static const char TAG[] = "SENSOR_TASK";
 
-void sensor_task(void *arg) {
+SAMPLE_BUS_DEFINE(sensor_samples, sensor_data_t, SAMPLE_BUS_DEPTH);
+SAMPLE_BUS_DEFINE(sensor_fingerprints, sensor_fingerprint_t, FINGERPRINT_BUS_DEPTH);
+
+/* Sub-measurement tracking of the continuous modes */
+typedef struct {
+    bool seen;              /* last_index is valid */
+    uint8_t last_index;     /* meas_index of the last published field */
+    uint32_t n_fields;      /* fields published in the current window */
+    uint32_t n_dropped;     /* sub-measurements overwritten before they were read, in the current window */
+    uint32_t total_dropped;
+    int64_t late_sum_us;    /* wake lateness of the published fields, in the current window */
+    int32_t late_max_us;
+    int64_t window_start_us;
+} seq_tracker_t;
+
+/* State of one sensor of the registry. All sensors are triggered together so their conversions overlap,
+ * then each one is read as soon as its own conversion is done */
+typedef struct {
+    struct bme68x_dev *dev;
+    uint8_t id;                 /* sensor id, the table position of bme680_sensor_id() */
+    bool busy;                  /* a measurement runs, step it at due_us */
+    bool restart;               /* start the measurement again at due_us */
+    int8_t rslt;                /* result of the last start or step */
+    int64_t due_us;
+    int32_t late_us;            /* how late the task woke up for the last step */
+    struct bme68x_async meas;
+    seq_tracker_t seq;
+    sensor_fingerprint_t fp;
+} sensor_slot_t;
+
+static sensor_slot_t slots[BME680_MAX_SENSORS];
+static uint8_t n_slots;
+
+/* Absolute deadlines of the forced measurements, every period_us on a grid aligned to the wall clock */
+typedef struct {
+    int64_t next_us;        /* next trigger, esp_timer time */
+    uint32_t period_us;
+    uint32_t n_samples;     /* triggers in the current window */
+    uint32_t n_overruns;    /* deadlines missed because a round ran past them, in the current window */
+    uint32_t total_overruns;
+    int64_t jitter_sum_us;  /* trigger lateness, in the current window */
+    int32_t jitter_max_us;
+    int64_t window_start_us;
+} sched_t;
+
+static sched_t sched;
+static volatile uint32_t period_ms = SENSOR_PERIOD_MS;
+
+/* Deadline wake-up, the timer notifies the sensor task */
+static esp_timer_handle_t wake_timer;
+static TaskHandle_t wake_task;
+static volatile bool wake_fired;
+
+/* Heater profile of the scan: target in degC and duration in ms of each step */
+static uint16_t profile_temp[SENSOR_PROFILE_LEN] = { 200, 240, 280, 320, 360, 400, 360, 320, 280, 240 };
+static uint16_t profile_dur[SENSOR_PROFILE_LEN] = { 100, 100, 100, 100, 100, 100, 100, 100, 100, 100 };
+
+/* Convert a compensated field to the sample layout */
+static void to_sample(const sensor_slot_t *s, const struct bme68x_data *data, sensor_data_t *sample) {
+    sample->sensor_id = s->id;
+    sample->wake_late_us = s->late_us;
+    sample->temperature = data->temperature;
+    sample->pressure = data->pressure;
+    sample->humidity = data->humidity;
+    sample->gas_resistance = data->gas_resistance;
+}
+
+/* Hand a compensated field to the consumers, written once into the sample bus */
+static void publish_sample(const sensor_slot_t *s, const struct bme68x_data *data) {
+    sensor_data_t *sample = sample_bus_claim(&sensor_samples);
+
+    if (sample == NULL) {
+        ESP_LOGE(TAG, "Sensor %u no free slot on the sample bus", s->id);
+        return;
+    }
+    to_sample(s, data, sample);
+    sample_bus_publish(&sensor_samples, sample);
+}
+
+/* Hand a complete or cut-short profile cycle to the consumers as one record on the fingerprint bus, then start
+ * the next one. The record is built over a whole cycle, so it is copied once into the bus when done */
+static void publish_fingerprint(sensor_fingerprint_t *fp) {
+    sensor_fingerprint_t *out = sample_bus_claim(&sensor_fingerprints);
+
+    if (out != NULL) {
+        *out = *fp;
+        sample_bus_publish(&sensor_fingerprints, out);
+    } else {
+        ESP_LOGE(TAG, "Sensor %u no free slot on the fingerprint bus", fp->sensor_id);
+    }
+
+    fp->cycle++;
+    fp->got_mask = 0;
+    fp->stable_mask = 0;
+}
+
+/* Returns true for a field not published yet and counts the sub-measurements lost before it */
+static bool seq_track(seq_tracker_t *seq, uint8_t meas_index, int32_t late_us) {
+    uint8_t step = (uint8_t)(meas_index - seq->last_index);
+
+    if (seq->seen) {
+        /* new_data stays set until the slot is reused, so a field can be read twice */
+        if (step == 0 || step >= 128) {
+            return false;
+        }
+        seq->n_dropped += step - 1U;
+        seq->total_dropped += step - 1U;
+    }
+
+    seq->seen = true;
+    seq->last_index = meas_index;
+    seq->n_fields++;
+    seq->late_sum_us += late_us;
+    if (late_us > seq->late_max_us) {
+        seq->late_max_us = late_us;
+    }
+    return true;
+}
+
+/* Log the achieved rate every SENSOR_STATS_PERIOD_MS and start a new window */
+static void seq_report(seq_tracker_t *seq, uint8_t id) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t elapsed_us = now_us - seq->window_start_us;
+
+    if (elapsed_us < (int64_t)SENSOR_STATS_PERIOD_MS * 1000) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Sensor %u %.2f fields/s, %lu dropped in %lld ms (%lu total), woke %lld us late on average, %ld max",
+             id, (double)seq->n_fields * 1e6 / (double)elapsed_us, (unsigned long)seq->n_dropped,
+             (long long)(elapsed_us / 1000), (unsigned long)seq->total_dropped,
+             (long long)(seq->n_fields ? seq->late_sum_us / seq->n_fields : 0), (long)seq->late_max_us);
+    seq->n_fields = 0;
+    seq->n_dropped = 0;
+    seq->late_sum_us = 0;
+    seq->late_max_us = 0;
+    seq->window_start_us = now_us;
+}
+
+/* Validate the sensor and heater configuration once and write it in a single transaction */
+static int8_t apply_conf(sensor_slot_t *s, uint8_t op_mode, struct bme68x_conf *conf,
+                         const struct bme68x_heatr_conf *heatr_conf) {
+    struct bme68x_conf_image image;
+
+    int8_t rslt = bme68x_compile_conf(op_mode, conf, heatr_conf, &image, s->dev);
+    if (rslt != BME68X_OK) {
+        ESP_LOGE(TAG, "Sensor %u invalid config: %i", s->id, rslt);
+        return rslt;
+    }
+    rslt = bme68x_set_conf_image(&image, s->dev);
+    if (rslt != BME68X_OK) {
+        ESP_LOGE(TAG, "Sensor %u failed to set config: %i", s->id, rslt);
+    }
+    return rslt;
+}
+
+/* Run the full self-test deferred from boot once a first sample is out, true when it ran */
+static bool run_selftest_if_due(sensor_slot_t *s) {
+    if (!bme68x_selftest_full_due(s->dev)) {
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Sensor %u running the full self-test", s->id);
+    int8_t rslt = bme68x_selftest_full(s->dev);
+    if (rslt != BME68X_OK) {
+        ESP_LOGE(TAG, "Sensor %u full self-test failed: %i", s->id, rslt);
+    } else {
+        ESP_LOGI(TAG, "Sensor %u full self-test OK", s->id);
+    }
+    return true;
+}
+
+/* Runs in the esp_timer task at the deadline */
+static void wake_timer_cb(void *arg) {
+    (void)arg;
+    wake_fired = true;
+    xTaskNotifyGive(wake_task);
+}
+
+/* Sleep until due_us and return how late the task woke up */
+static int32_t sleep_until(int64_t due_us) {
+    int64_t wait_us = due_us - esp_timer_get_time();
+
+    if (wait_us > 0) {
+#if SENSOR_WAIT_MODE == SENSOR_WAIT_TIMER
+        wake_fired = false;
+        if (wake_timer && esp_timer_start_once(wake_timer, (uint64_t)wait_us) == ESP_OK) {
+            /* A notification meant for something else only costs a loop */
+            while (!wake_fired) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+        } else {
+            vTaskDelay((TickType_t)DIV_ROUND_UP(wait_us, portTICK_PERIOD_MS * 1000) + 1);
+        }
+#else
+        /* Whole ticks, rounded up so the read is never early */
+        vTaskDelay((TickType_t)DIV_ROUND_UP(wait_us, portTICK_PERIOD_MS * 1000));
+#endif
+    }
+    return (int32_t)(esp_timer_get_time() - due_us);
+}
+
+/* Step again after the wait the driver asked for, while it reports busy */
+static void slot_schedule(sensor_slot_t *s) {
+    s->busy = (s->rslt == BME68X_W_ASYNC_BUSY);
+    s->due_us = esp_timer_get_time() + (int64_t)s->meas.wait_us;
+}
+
+/* Start a measurement on one sensor */
+static void slot_start(sensor_slot_t *s, uint8_t op_mode, uint32_t meas_us) {
+    s->rslt = bme68x_async_start(op_mode, meas_us, &s->meas, s->dev);
+    slot_schedule(s);
+}
+
+/* After a failure: refill the register shadow and start over in a second, the other sensors keep going */
+static void slot_retry(sensor_slot_t *s) {
+    if (s->rslt < BME68X_OK) {
+        (void)bme68x_sync_shadow(s->dev);
+    }
+    s->busy = false;
+    s->restart = true;
+    s->due_us = esp_timer_get_time() + 1000000;
+}
+
+/* Sleep until the sensor due first, step or restart it and return it. NULL when none is running */
+static sensor_slot_t *step_next(void) {
+    sensor_slot_t *s = NULL;
+
+    for (uint8_t i = 0; i < n_slots; i++) {
+        if ((slots[i].busy || slots[i].restart) && (s == NULL || slots[i].due_us < s->due_us)) {
+            s = &slots[i];
+        }
+    }
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->late_us = sleep_until(s->due_us);
+
+    if (s->restart) {
+        s->restart = false;
+        s->rslt = bme68x_async_start(s->meas.op_mode, s->meas.meas_dur, &s->meas, s->dev);
+    } else {
+        s->rslt = bme68x_async_step(&s->meas, s->dev);
+    }
+    slot_schedule(s);
+    return s;
+}
+
+void sensor_set_period_ms(uint32_t ms) {
+    if (ms > 0) {
+        period_ms = ms;
+    }
+}
+
+uint32_t sensor_get_period_ms(void) {
+    return period_ms;
+}
+
+/* Put the next deadline on the next multiple of SENSOR_ALIGN_MS of the wall clock, or right now */
+static void sched_align(sched_t *sc) {
+    int64_t now_us = esp_timer_get_time();
+
+    sc->period_us = period_ms * 1000U;
+    sc->next_us = now_us;
+#if SENSOR_ALIGN_MS > 0
+    struct timeval tv;
+    const int64_t align_us = (int64_t)SENSOR_ALIGN_MS * 1000;
+
+    gettimeofday(&tv, NULL);
+    int64_t wall_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    sc->next_us += (align_us - (wall_us % align_us)) % align_us;
+#endif
+}
+
+/* Move to the next deadline, a round that ran past some skips them and keeps the grid */
+static void sched_advance(sched_t *sc) {
+    if (sc->period_us != period_ms * 1000U) {
+        sched_align(sc);
+        return;
+    }
+
+    sc->next_us += sc->period_us;
+    int64_t behind_us = esp_timer_get_time() - sc->next_us;
+    if (behind_us > 0) {
+        uint32_t missed = (uint32_t)(behind_us / sc->period_us) + 1U;
+
+        sc->next_us += (int64_t)missed * sc->period_us;
+        sc->n_overruns += missed;
+        sc->total_overruns += missed;
+    }
+}
+
+/* Count how late a trigger was */
+static void sched_track(sched_t *sc, int32_t jitter_us) {
+    sc->n_samples++;
+    sc->jitter_sum_us += jitter_us;
+    if (jitter_us > sc->jitter_max_us) {
+        sc->jitter_max_us = jitter_us;
+    }
+}
+
+/* Log the jitter and overruns every SENSOR_STATS_PERIOD_MS and start a new window */
+static void sched_report(sched_t *sc) {
+    int64_t now_us = esp_timer_get_time();
+    int64_t elapsed_us = now_us - sc->window_start_us;
+
+    if (elapsed_us < (int64_t)SENSOR_STATS_PERIOD_MS * 1000) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "%lu samples every %lu ms in %lld ms, jitter %lld us on average, %ld max, %lu overruns (%lu total)",
+             (unsigned long)sc->n_samples, (unsigned long)(sc->period_us / 1000U), (long long)(elapsed_us / 1000),
+             (long long)(sc->n_samples ? sc->jitter_sum_us / sc->n_samples : 0), (long)sc->jitter_max_us,
+             (unsigned long)sc->n_overruns, (unsigned long)sc->total_overruns);
+    sc->n_samples = 0;
+    sc->n_overruns = 0;
+    sc->jitter_sum_us = 0;
+    sc->jitter_max_us = 0;
+    sc->window_start_us = now_us;
+}
+
+/* One forced measurement on every sensor each period, on absolute deadlines. The conversions overlap */
+static void run_forced(void) {
     struct bme68x_conf conf = {
         .os_hum = BME68X_OS_2X,
         .os_temp = BME68X_OS_4X,
@@ -29,55 +356,366 @@ void sensor_task(void *arg) {
         .heatr_dur = 100,
     };
 
-    int8_t rslt = bme68x_set_conf(&conf, &bme);
-    if (rslt != BME68X_OK) {
-        ESP_LOGE(TAG, "Failed to set sensor config: %i", rslt);
+    for (uint8_t i = 0; i < n_slots; i++) {
+        (void)apply_conf(&slots[i], BME68X_FORCED_MODE, &conf, &heatr_conf);
     }
-    rslt = bme68x_set_heatr_conf(BME68X_FORCED_MODE, &heatr_conf, &bme);
-    if (rslt != BME68X_OK) {
-        ESP_LOGE(TAG, "Failed to set heater config: %i", rslt);
+    sched_align(&sched);
+    sched.window_start_us = esp_timer_get_time();
+
+    while (1) {
+
+        /* The period counts from deadline to deadline, whatever the round costs */
+        sched_track(&sched, sleep_until(sched.next_us));
+
+        /* Trigger every sensor, the task sleeps instead of the driver spinning */
+        for (uint8_t i = 0; i < n_slots; i++) {
+            uint32_t meas_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, slots[i].dev) +
+                ((uint32_t)heatr_conf.heatr_dur * 1000U);
+            slot_start(&slots[i], BME68X_FORCED_MODE, (meas_us > SENSOR_EARLY_WAKE_US) ?
+                       meas_us - SENSOR_EARLY_WAKE_US : meas_us);
+            if (slots[i].rslt < BME68X_OK) {
+                ESP_LOGE(TAG, "Sensor %u measurement failed: %i", slots[i].id, slots[i].rslt);
+                /* The register shadow is dropped on a failed write, refill it */
+                (void)bme68x_sync_shadow(slots[i].dev);
+            }
+        }
+
+        /* Read them in the order they finish */
+        sensor_slot_t *s;
+        while ((s = step_next()) != NULL) {
+            if (s->busy) {
+                continue;
+            }
+            if (s->rslt < BME68X_OK) {
+                ESP_LOGE(TAG, "Sensor %u measurement failed: %i", s->id, s->rslt);
+                (void)bme68x_sync_shadow(s->dev);
+            } else if (s->rslt == BME68X_OK && s->meas.n_data > 0) {
+                publish_sample(s, &s->meas.data[0]);
+            } else {
+                ESP_LOGD(TAG, "Sensor %u no new data available", s->id);
+            }
+        }
+
+        /* The self-test reset the sensor */
+        for (uint8_t i = 0; i < n_slots; i++) {
+            if (run_selftest_if_due(&slots[i])) {
+                (void)apply_conf(&slots[i], BME68X_FORCED_MODE, &conf, &heatr_conf);
+            }
+        }
+
+        sched_advance(&sched);
+        sched_report(&sched);
+    }
+}
+
+/* Forced measurements back to back on every sensor. A finished frame is read raw and the next conversion triggered
+ * right away, then the frame is compensated and published while the sensor converts */
+static void run_pipelined(void) {
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_2X,
+        .os_temp = BME68X_OS_4X,
+        .os_pres = BME68X_OS_4X,
+        .filter = BME68X_FILTER_SIZE_3,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp = 300,
+        .heatr_dur = 100,
+    };
+    uint32_t meas_us[BME680_MAX_SENSORS];
+
+    for (uint8_t i = 0; i < n_slots; i++) {
+        sensor_slot_t *s = &slots[i];
+
+        meas_us[i] = bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, s->dev) + ((uint32_t)heatr_conf.heatr_dur * 1000U);
+        s->meas.raw = 1;
+        (void)apply_conf(s, BME68X_FORCED_MODE, &conf, &heatr_conf);
+        slot_start(s, BME68X_FORCED_MODE, meas_us[i]);
+        s->seq.window_start_us = esp_timer_get_time();
+        if (s->rslt != BME68X_W_ASYNC_BUSY) {
+            slot_retry(s);
+        }
+    }
+
+    while (1) {
+        sensor_slot_t *s = step_next();
+        struct bme68x_raw_data frame;
+        struct bme68x_data data;
+
+        if (s->busy) {
+            continue;
+        }
+
+        if (s->rslt < BME68X_OK) {
+            ESP_LOGE(TAG, "Sensor %u measurement failed: %i", s->id, s->rslt);
+            slot_retry(s);
+            continue;
+        }
+
+        /* The next conversion runs while this frame is processed */
+        bool got = (s->rslt == BME68X_OK && s->meas.n_data > 0);
+        frame = s->meas.raw_data[0];
+        slot_start(s, BME68X_FORCED_MODE, meas_us[s - slots]);
+        if (s->rslt != BME68X_W_ASYNC_BUSY) {
+            ESP_LOGE(TAG, "Sensor %u measurement failed: %i", s->id, s->rslt);
+            slot_retry(s);
+        }
+
+        if (got) {
+            (void)bme68x_compensate_raw(&frame, 1, &data, &s->dev->calib, s->dev->variant_id);
+            publish_sample(s, &data);
+            s->seq.n_fields++;
+            s->seq.late_sum_us += s->late_us;
+            if (s->late_us > s->seq.late_max_us) {
+                s->seq.late_max_us = s->late_us;
+            }
+        } else {
+            ESP_LOGD(TAG, "Sensor %u no new data available", s->id);
+        }
+
+        /* The self-test reset the sensor and dropped the running conversion */
+        if (got && run_selftest_if_due(s)) {
+            (void)apply_conf(s, BME68X_FORCED_MODE, &conf, &heatr_conf);
+            slot_start(s, BME68X_FORCED_MODE, meas_us[s - slots]);
+            if (s->rslt != BME68X_W_ASYNC_BUSY) {
+                slot_retry(s);
+            }
+        }
+
+        seq_report(&s->seq, s->id);
+    }
+}
+
+/* Parallel and sequential mode only exist on the BME688, leave the other sensors out. False when none is left */
+static bool keep_bme688(const char *mode) {
+    uint8_t n = 0;
+
+    for (uint8_t i = 0; i < n_slots; i++) {
+        if (slots[i].dev->variant_id != BME68X_VARIANT_GAS_HIGH) {
+            ESP_LOGE(TAG, "Sensor %u is a BME680, %s mode needs a BME688", slots[i].id, mode);
+            continue;
+        }
+        slots[n++] = slots[i];
+    }
+    n_slots = n;
+
+    return n_slots > 0;
+}
+
+/* Continuous parallel mode on every BME688, every new field is published */
+static void run_parallel(void) {
+    static uint16_t temp_prof[] = { 320 };
+    static uint16_t mul_prof[] = { 1 };
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X,
+        .os_temp = BME68X_OS_2X,
+        .os_pres = BME68X_OS_1X,
+        .filter = BME68X_FILTER_OFF,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp_prof = temp_prof,
+        .heatr_dur_prof = mul_prof,
+        .profile_len = sizeof(temp_prof) / sizeof(temp_prof[0]),
+    };
+
+    if (!keep_bme688("parallel")) {
+        return;
+    }
+
+    /* The heater gets what is left of the step once TPH is done */
+    uint32_t tph_us = bme68x_get_meas_dur(BME68X_PARALLEL_MODE, &conf, slots[0].dev);
+    heatr_conf.shared_heatr_dur = (uint16_t)(SENSOR_PAR_STEP_MS - (tph_us / 1000U));
+
+    /* One new field per step, read once per step so the 3 field ring never wraps */
+    uint32_t step_us = tph_us + ((uint32_t)heatr_conf.shared_heatr_dur * 1000U);
+    for (uint8_t i = 0; i < n_slots; i++) {
+        (void)apply_conf(&slots[i], BME68X_PARALLEL_MODE, &conf, &heatr_conf);
+        slot_start(&slots[i], BME68X_PARALLEL_MODE, step_us);
+        slots[i].seq.window_start_us = esp_timer_get_time();
+        if (slots[i].rslt != BME68X_W_ASYNC_BUSY) {
+            slot_retry(&slots[i]);
+        }
     }
 
     while (1) {
+        sensor_slot_t *s = step_next();
+
+        if (s->busy) {
+            continue;
+        }
+
+        if (s->rslt == BME68X_OK) {
+            /* New fields come oldest first */
+            for (uint8_t i = 0; i < s->meas.n_data; i++) {
+                if (seq_track(&s->seq, s->meas.data[i].meas_index, s->late_us)) {
+                    publish_sample(s, &s->meas.data[i]);
+                }
+            }
+
+            /* Still running, next read one step later */
+            s->busy = true;
+
+            /* The self-test reset the sensor, start over */
+            if (s->seq.seen && run_selftest_if_due(s)) {
+                (void)apply_conf(s, BME68X_PARALLEL_MODE, &conf, &heatr_conf);
+                s->seq.seen = false;
+                slot_start(s, BME68X_PARALLEL_MODE, step_us);
+            }
+        } else {
+            ESP_LOGE(TAG, "Sensor %u parallel mode read failed: %i", s->id, s->rslt);
+            slot_retry(s);
+
+            /* The sub-measurement index may restart, do not count the gap as drops */
+            s->seq.seen = false;
+        }
+
+        seq_report(&s->seq, s->id);
+    }
+}
+
+/* Sequential mode over the heater profile on every BME688, the fields of a cycle are published as one fingerprint */
+static void run_profile(void) {
+    struct bme68x_conf conf = {
+        .os_hum = BME68X_OS_1X,
+        .os_temp = BME68X_OS_2X,
+        .os_pres = BME68X_OS_1X,
+        .filter = BME68X_FILTER_OFF,
+        .odr = BME68X_ODR_NONE,
+    };
+    struct bme68x_heatr_conf heatr_conf = {
+        .enable = BME68X_ENABLE,
+        .heatr_temp_prof = profile_temp,
+        .heatr_dur_prof = profile_dur,
+        .profile_len = SENSOR_PROFILE_LEN,
+    };
+    const uint16_t full_mask = (uint16_t)((1U << SENSOR_PROFILE_LEN) - 1U);
+    uint16_t min_dur = profile_dur[0];
+
+    if (!keep_bme688("sequential")) {
+        return;
+    }
+
+    /* Read once per shortest step so the 3 field ring never wraps */
+    for (uint8_t i = 0; i < SENSOR_PROFILE_LEN; i++) {
+        if (profile_dur[i] < min_dur) {
+            min_dur = profile_dur[i];
+        }
+    }
+    uint32_t step_us = bme68x_get_meas_dur(BME68X_SEQUENTIAL_MODE, &conf, slots[0].dev) +
+        ((uint32_t)min_dur * 1000U);
 
-        /* Local variables */
-        sensor_data_t sample = {0};
-        struct bme68x_data data = {0};
-        uint8_t nData = 0;
+    for (uint8_t i = 0; i < n_slots; i++) {
+        sensor_slot_t *s = &slots[i];
 
-        /* Trigger a forced measurement */
-        rslt = bme68x_set_op_mode(BME68X_FORCED_MODE, &bme);
-        if (rslt != BME68X_OK) {
-            ESP_LOGE(TAG, "Failed to set op mode: %i", rslt);
-            vTaskDelay(pdMS_TO_TICKS(1000));
+        s->fp.sensor_id = s->id;
+        for (uint8_t j = 0; j < SENSOR_PROFILE_LEN; j++) {
+            s->fp.heatr_temp[j] = profile_temp[j];
+        }
+        (void)apply_conf(s, BME68X_SEQUENTIAL_MODE, &conf, &heatr_conf);
+        slot_start(s, BME68X_SEQUENTIAL_MODE, step_us);
+        s->seq.window_start_us = esp_timer_get_time();
+        if (s->rslt != BME68X_W_ASYNC_BUSY) {
+            slot_retry(s);
+        }
+    }
+
+    while (1) {
+        sensor_slot_t *s = step_next();
+        sensor_fingerprint_t *fp = &s->fp;
+
+        if (s->busy) {
             continue;
         }
-        uint32_t meas_us = bme68x_get_meas_dur(BME68X_FORCED_MODE, &conf, &bme) +
-            ((uint32_t)heatr_conf.heatr_dur * 1000U);
-        vTaskDelay(pdMS_TO_TICKS((meas_us + 999) / 1000));
-
-        /* Read raw sensor data */
-        rslt = bme68x_get_data(BME68X_FORCED_MODE, &data, &nData, &bme);
-        if (rslt == BME68X_OK && nData > 0) {
-            /* Process and store the data */
-            sample.temperature = data.temperature;
-            sample.pressure = data.pressure;
-            sample.humidity = data.humidity;
-            sample.gas_resistance = data.gas_resistance;
-
-            /* Log the sensor data */
-            ESP_LOGI(TAG, "Temperature: %.2f, Pressure: %.2f, Humidity: %.2f, Gas Resistance: %.2f",
-                     sample.temperature, sample.pressure, sample.humidity, sample.gas_resistance);
-
-            /* Send the data to the queue
-            xQueueSend(arg, &sample, portMAX_DELAY);*/
-        } else if (rslt == BME68X_W_NO_NEW_DATA || nData == 0) {
-            ESP_LOGD(TAG, "No new data available");
+
+        if (s->rslt == BME68X_OK) {
+            for (uint8_t i = 0; i < s->meas.n_data; i++) {
+                const struct bme68x_data *d = &s->meas.data[i];
+
+                if ((d->gas_index >= SENSOR_PROFILE_LEN) || !seq_track(&s->seq, d->meas_index, s->late_us)) {
+                    continue;
+                }
+
+                /* Step 0, or a step already filled, starts the next cycle */
+                if ((d->gas_index == 0 || (fp->got_mask & (1U << d->gas_index))) && fp->got_mask) {
+                    publish_fingerprint(fp);
+                }
+
+                to_sample(s, d, &fp->steps[d->gas_index]);
+                fp->got_mask |= (uint16_t)(1U << d->gas_index);
+                if ((d->status & BME68X_GASM_VALID_MSK) && (d->status & BME68X_HEAT_STAB_MSK)) {
+                    fp->stable_mask |= (uint16_t)(1U << d->gas_index);
+                }
+
+                if (fp->got_mask == full_mask) {
+                    publish_fingerprint(fp);
+                }
+            }
+
+            /* Still running, next read one step later */
+            s->busy = true;
+
+            /* Between two cycles the self-test costs no partial fingerprint */
+            if (fp->cycle > 0 && fp->got_mask == 0 && run_selftest_if_due(s)) {
+                (void)apply_conf(s, BME68X_SEQUENTIAL_MODE, &conf, &heatr_conf);
+                s->seq.seen = false;
+                slot_start(s, BME68X_SEQUENTIAL_MODE, step_us);
+            }
         } else {
-            ESP_LOGE(TAG, "Failed to read sensor data: %i", rslt);
+            ESP_LOGE(TAG, "Sensor %u sequential mode read failed: %i", s->id, s->rslt);
+            slot_retry(s);
+
+            /* The profile restarts at step 0 */
+            s->seq.seen = false;
+            fp->got_mask = 0;
+            fp->stable_mask = 0;
         }
 
-        /* Wait before the next reading */
-        vTaskDelay(pdMS_TO_TICKS(5000)); // 5 seconds
+        seq_report(&s->seq, s->id);
+    }
+}
+
+void sensor_task(void *arg) {
+    (void)arg;
+
+    n_slots = bme680_registry_count();
+    for (uint8_t i = 0; i < n_slots; i++) {
+        slots[i].dev = bme680_registry_get(i);
+        slots[i].id = bme680_sensor_id(slots[i].dev);
+        slots[i].meas.poll_us = SENSOR_POLL_US;
+    }
+    if (n_slots == 0) {
+        ESP_LOGE(TAG, "No sensor");
+        vTaskDelete(NULL);
+        return;
     }
+
+#if SENSOR_WAIT_MODE == SENSOR_WAIT_TIMER
+    wake_task = xTaskGetCurrentTaskHandle();
+    esp_timer_create_args_t timerCfg = {
+        .callback = wake_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "sensor_wake",
+    };
+    if (esp_timer_create(&timerCfg, &wake_timer) != ESP_OK) {
+        ESP_LOGW(TAG, "No wake-up timer, sleeping in ticks");
+        wake_timer = NULL;
+    }
+#endif
+
+    if (SENSOR_ACQ_MODE == SENSOR_ACQ_PARALLEL) {
+        run_parallel();
+    } else if (SENSOR_ACQ_MODE == SENSOR_ACQ_PROFILE) {
+        run_profile();
+    } else if (SENSOR_ACQ_MODE == SENSOR_ACQ_PIPELINED) {
+        run_pipelined();
+    } else {
+        run_forced();
+    }
+
+    /* Only the BME688 modes give up, when no sensor supports them */
+    ESP_LOGE(TAG, "No sensor for the acquisition mode");
+    vTaskDelete(NULL);
 }
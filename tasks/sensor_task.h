@@ -5,9 +5,58 @@
 #ifndef LAERA_FW_SENSOR_TASK_H
 #define LAERA_FW_SENSOR_TASK_H
 
-#include "sensor_task.h"
+#include "sample_bus.h"
 
 
+/* ----------------------------- Configuration ---------------------------------- */
+
+/* Acquisition modes, select one with SENSOR_ACQ_MODE */
+#define SENSOR_ACQ_FORCED       0   /* One forced measurement every SENSOR_PERIOD_MS */
+#define SENSOR_ACQ_PARALLEL     1   /* Continuous parallel mode, every field is published. BME688 only */
+#define SENSOR_ACQ_PROFILE      2   /* Sequential mode heater profile scan, one fingerprint per cycle. BME688 only */
+#define SENSOR_ACQ_PIPELINED    3   /* Forced measurements back to back, a frame is processed during the next conversion */
+
+#ifndef SENSOR_ACQ_MODE
+#define SENSOR_ACQ_MODE         SENSOR_ACQ_FORCED
+#endif
+
+/* How the task sleeps until a conversion is due, select one with SENSOR_WAIT_MODE */
+#define SENSOR_WAIT_TICK        0   /* vTaskDelay, rounded to the tick */
+#define SENSOR_WAIT_TIMER       1   /* One-shot esp_timer at the deadline, wakes the task with a notification */
+
+#ifndef SENSOR_WAIT_MODE
+#define SENSOR_WAIT_MODE        SENSOR_WAIT_TIMER
+#endif
+
+/* Forced mode: wake this long before the computed end of the conversion and poll the new data bit */
+#ifndef SENSOR_EARLY_WAKE_US
+#define SENSOR_EARLY_WAKE_US    0
+#endif
+
+/* Time between two polls for new data when a read came too early */
+#ifndef SENSOR_POLL_US
+#define SENSOR_POLL_US          500
+#endif
+
+/* Time between two forced measurements at boot, refer sensor_set_period_ms() */
+#ifndef SENSOR_PERIOD_MS
+#define SENSOR_PERIOD_MS        5000
+#endif
+
+/* Forced measurements start on multiples of this wall clock period, 0 starts the grid right away */
+#ifndef SENSOR_ALIGN_MS
+#define SENSOR_ALIGN_MS         1000
+#endif
+
+/* Duration of one parallel mode step, TPH conversion plus heater time */
+#define SENSOR_PAR_STEP_MS      140
+
+/* Window of the rate and drop statistics of the continuous modes */
+#define SENSOR_STATS_PERIOD_MS  10000
+
+/* Number of heater steps of the profile scan, at most 10 */
+#define SENSOR_PROFILE_LEN      10
+
 /* ----------------------------- Data structures ---------------------------------- */
 typedef struct {
     TaskHandle_t task_handle;
@@ -21,11 +70,35 @@ typedef struct {
     float humidity;
     float pressure;
     float gas_resistance;
+    uint8_t sensor_id;                          /* Table position of the sensor, refer bme680_sensor_id() */
+    int32_t wake_late_us;                       /* How long after the read was due the task woke up for it */
 } sensor_data_t;
 
+/* Gas fingerprint, the fields of one heater profile cycle in gas_index order */
+typedef struct {
+    uint8_t sensor_id;                          /* Table position of the sensor, refer bme680_sensor_id() */
+    uint32_t cycle;                             /* Cycle counter, starts at 0 */
+    uint16_t got_mask;                          /* Bit n set when step n was read */
+    uint16_t stable_mask;                       /* Bit n set when step n had a valid gas reading at a stable heater */
+    uint16_t heatr_temp[SENSOR_PROFILE_LEN];    /* Heater target of each step in degC */
+    sensor_data_t steps[SENSOR_PROFILE_LEN];
+} sensor_fingerprint_t;
+
+/* Samples of the forced, parallel and pipelined modes, items are sensor_data_t */
+extern sample_bus_t sensor_samples;
+
+/* Fingerprints of the profile scan, items are sensor_fingerprint_t */
+extern sample_bus_t sensor_fingerprints;
+
 /* ----------------------------- Function prototypes ---------------------------------- */
 
 void sensor_task(void *arg);
 
+/* Change the time between two forced measurements, from the next one on. The grid is aligned again */
+void sensor_set_period_ms(uint32_t period_ms);
+
+/* Current time between two forced measurements */
+uint32_t sensor_get_period_ms(void);
+
 
 #endif //LAERA_FW_SENSOR_TASK_H
\ No newline at end of file